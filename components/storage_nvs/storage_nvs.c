@@ -1,35 +1,161 @@
+#include <string.h>
 #include "storage_nvs.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #define TAG "NVS"
 
 #define STORAGE_NAMESPACE "storage"
 
+// 常读的 key 缓存在内存中，写入或删除时失效
+typedef struct {
+    const char* key;
+    uint8_t* value;    // 第一次读取时分配，STORAGE_NVS_CACHE_VALUE_MAX 字节
+    uint32_t len;
+    esp_err_t result;  // 缓存的读取结果，ESP_ERR_NVS_NOT_FOUND 也会缓存
+    bool valid;
+} storage_nvs_cache_t;
+
 static nvs_handle_t storage_handle;
+static SemaphoreHandle_t cache_lock;
+static storage_nvs_cache_t cache_list[] = {
+    { .key = "volume" },
+    { .key = "wifiCfg" },
+};
 
 void storage_nvs_init() {
     esp_err_t err = nvs_open(STORAGE_NAMESPACE, NVS_READWRITE, &storage_handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "NVS Init Failed");
     }
+    if (cache_lock == NULL) {
+        cache_lock = xSemaphoreCreateMutex();
+    }
+}
+
+static storage_nvs_cache_t* storage_nvs_cache_find(const char* key) {
+    for (int i = 0; i < sizeof(cache_list) / sizeof(cache_list[0]); i++) {
+        if (strcmp(cache_list[i].key, key) == 0) {
+            return &cache_list[i];
+        }
+    }
+    return NULL;
+}
+
+// 写入或删除期间持有缓存锁，并发的读取不会在写入完成前把旧值重新读进缓存
+static void storage_nvs_cache_lock(void) {
+    if (cache_lock) {
+        xSemaphoreTake(cache_lock, portMAX_DELAY);
+    }
+}
+
+// 写入完成后使缓存失效并释放锁，key 为 NULL 时全部失效
+static void storage_nvs_cache_unlock(const char* key) {
+    if (cache_lock == NULL) {
+        return;
+    }
+    for (int i = 0; i < sizeof(cache_list) / sizeof(cache_list[0]); i++) {
+        if (key == NULL || strcmp(cache_list[i].key, key) == 0) {
+            cache_list[i].valid = false;
+        }
+    }
+    xSemaphoreGive(cache_lock);
+}
+
+// 读到调用者的缓冲，常读的 key 优先从缓存拷贝
+static esp_err_t storage_nvs_read_to(const char* key, void* buffer, uint32_t* len, bool is_str) {
+    if (!storage_handle || buffer == NULL || len == NULL) {
+        return ESP_FAIL;
+    }
+    storage_nvs_cache_t* cache = storage_nvs_cache_find(key);
+    if (cache == NULL || cache_lock == NULL) {
+        size_t size = *len;
+        esp_err_t err = is_str ? nvs_get_str(storage_handle, key, buffer, &size) : nvs_get_blob(storage_handle, key, buffer, &size);
+        *len = size;
+        return err;
+    }
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    if (cache->valid == false) {
+        if (cache->value == NULL) {
+            cache->value = heap_caps_malloc(STORAGE_NVS_CACHE_VALUE_MAX, MALLOC_CAP_8BIT);
+        }
+        size_t size = STORAGE_NVS_CACHE_VALUE_MAX;
+        cache->result = cache->value == NULL ? ESP_ERR_NO_MEM
+                        : is_str            ? nvs_get_str(storage_handle, key, (char*)cache->value, &size)
+                                            : nvs_get_blob(storage_handle, key, cache->value, &size);
+        cache->len = size;
+        // 太长的值不缓存，下次直接读 flash
+        cache->valid = cache->result == ESP_OK || cache->result == ESP_ERR_NVS_NOT_FOUND;
+    }
+    esp_err_t err = cache->result;
+    if (cache->valid == false) {
+        xSemaphoreGive(cache_lock);
+        size_t size = *len;
+        err = is_str ? nvs_get_str(storage_handle, key, buffer, &size) : nvs_get_blob(storage_handle, key, buffer, &size);
+        *len = size;
+        return err;
+    }
+    if (err == ESP_OK) {
+        if (*len < cache->len) {
+            err = ESP_ERR_NVS_INVALID_LENGTH;
+        } else {
+            memcpy(buffer, cache->value, cache->len);
+        }
+        *len = cache->len;
+    }
+    xSemaphoreGive(cache_lock);
+    return err;
+}
+
+esp_err_t storage_nvs_read_blob_to(const char* key, void* value, uint32_t* len) {
+    return storage_nvs_read_to(key, value, len, false);
+}
+
+esp_err_t storage_nvs_read_str_to(const char* key, char* string, uint32_t* len) {
+    return storage_nvs_read_to(key, string, len, true);
 }
 
 esp_err_t storage_nvs_write_blob(const char* key, const void* value, uint32_t len) {
     if (!storage_handle) {
         return ESP_FAIL;
     }
+    storage_nvs_cache_lock();
     nvs_set_blob(storage_handle, key, value, len);
-    return nvs_commit(storage_handle);
+    esp_err_t err = nvs_commit(storage_handle);
+    storage_nvs_cache_unlock(key);
+    return err;
 }
 
 esp_err_t storage_nvs_write_str(const char* key, const char* str) {
     if (!storage_handle) {
         return ESP_FAIL;
     }
+    storage_nvs_cache_lock();
     nvs_set_str(storage_handle, key, str);
+    esp_err_t err = nvs_commit(storage_handle);
+    storage_nvs_cache_unlock(key);
+    return err;
+}
+
+esp_err_t storage_nvs_set_blob(const char* key, const void* value, uint32_t len) {
+    if (!storage_handle) {
+        return ESP_FAIL;
+    }
+    storage_nvs_cache_lock();
+    esp_err_t err = nvs_set_blob(storage_handle, key, value, len);
+    storage_nvs_cache_unlock(key);
+    return err;
+}
+
+esp_err_t storage_nvs_commit() {
+    if (!storage_handle) {
+        return ESP_FAIL;
+    }
     return nvs_commit(storage_handle);
 }
 
@@ -97,11 +223,17 @@ esp_err_t storage_nvs_read_blob(const char* key, void** value, uint32_t* len) {
 esp_err_t storage_nvs_reset() {
     // nvs_erase_key(storage_handle, "wifiCfg");
     // nvs_erase_key(storage_handle, "nikeName");
+    storage_nvs_cache_lock();
     nvs_erase_all(storage_handle);
-    return nvs_commit(storage_handle);
+    esp_err_t err = nvs_commit(storage_handle);
+    storage_nvs_cache_unlock(NULL);
+    return err;
 }
 
 esp_err_t storage_nvs_erase_key(const char* key) {
+    storage_nvs_cache_lock();
     nvs_erase_key(storage_handle, key);
-    return nvs_commit(storage_handle);
+    esp_err_t err = nvs_commit(storage_handle);
+    storage_nvs_cache_unlock(key);
+    return err;
 }
@@ -2,6 +2,10 @@
 
 #include "esp_err.h"
 #include "stdio.h"
+#include "stdbool.h"
+
+// 常读 key 缓存的最大长度，超过的值不缓存
+#define STORAGE_NVS_CACHE_VALUE_MAX 256
 
 
 void storage_nvs_init();
@@ -10,10 +14,21 @@ esp_err_t storage_nvs_write_blob(const char* key, const void* value, uint32_t le
 
 esp_err_t storage_nvs_write_str(const char* key, const char* str);
 
+// 只写入不提交，多次写入后调用 storage_nvs_commit 一次提交
+esp_err_t storage_nvs_set_blob(const char* key, const void* value, uint32_t len);
+
+esp_err_t storage_nvs_commit();
+
 esp_err_t storage_nvs_read_str(const char* key, char** string, uint32_t* len);
 
 esp_err_t storage_nvs_read_blob(const char* key, void** value, uint32_t* len);
 
+// 读到调用者提供的缓冲，不分配内存；len 传入缓冲大小，返回实际长度
+// volume、wifiCfg 等常读的 key 读取一次后缓存在内存中，之后的读取只是 memcpy
+esp_err_t storage_nvs_read_blob_to(const char* key, void* value, uint32_t* len);
+
+esp_err_t storage_nvs_read_str_to(const char* key, char* string, uint32_t* len);
+
 esp_err_t storage_nvs_erase_key(const char* key);
 
 esp_err_t storage_nvs_reset();
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "storage_nvs.h"
+#include "storage_settings.h"
+
+#define TAG "NVS.settings"
+
+typedef struct {
+    const char* key;
+    uint8_t size;   // 在 NVS 中以 size 字节的 blob 保存，与旧版本的存储格式兼容
+    int32_t def;    // 默认值
+} storage_setting_desc_t;
+
+static const storage_setting_desc_t setting_desc[STORAGE_SETTING_MAX] = {
+    [STORAGE_SETTING_VOLUME] = { "volume", sizeof(uint8_t), 60 },
+};
+
+static int32_t setting_value[STORAGE_SETTING_MAX];
+static uint32_t setting_dirty = 0;  // 按位标记未写入 NVS 的设置
+static SemaphoreHandle_t setting_lock;
+static esp_timer_handle_t setting_timer;
+static TaskHandle_t setting_task;
+
+// esp_timer 的回调在共用的 esp_timer 任务中执行，不能在里面等锁和写 flash，只通知写入任务
+static void storage_settings_timer_cb(void* arg) {
+    xTaskNotifyGive(setting_task);
+}
+
+static void storage_settings_task(void* arg) {
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        storage_settings_flush();
+    }
+}
+
+static void storage_settings_shutdown(void) {
+    if (setting_dirty) {
+        ESP_LOGI(TAG, "flush before restart");
+        storage_settings_flush();
+    }
+}
+
+void storage_settings_init() {
+    if (setting_lock) {
+        return;
+    }
+    setting_lock = xSemaphoreCreateMutex();
+    for (int i = 0; i < STORAGE_SETTING_MAX; i++) {
+        int32_t value = 0;
+        uint32_t len = setting_desc[i].size;
+        // 小端，按实际长度读入 int32 的低字节
+        setting_value[i] = storage_nvs_read_blob_to(setting_desc[i].key, &value, &len) == ESP_OK && len == setting_desc[i].size ? value : setting_desc[i].def;
+        ESP_LOGI(TAG, "%s: %ld", setting_desc[i].key, setting_value[i]);
+    }
+
+    xTaskCreate(storage_settings_task, "settings_commit", STORAGE_SETTINGS_TASK_STACK, NULL, STORAGE_SETTINGS_TASK_PRIORITY, &setting_task);
+    const esp_timer_create_args_t timer_args = {
+        .callback = storage_settings_timer_cb,
+        .name = "settings_commit",
+    };
+    esp_timer_create(&timer_args, &setting_timer);
+    esp_register_shutdown_handler(storage_settings_shutdown);
+}
+
+int32_t storage_settings_get(storage_setting_id_t id) {
+    if (id >= STORAGE_SETTING_MAX) {
+        return 0;
+    }
+    return setting_lock ? setting_value[id] : setting_desc[id].def;
+}
+
+void storage_settings_set(storage_setting_id_t id, int32_t value) {
+    if (id >= STORAGE_SETTING_MAX || setting_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(setting_lock, portMAX_DELAY);
+    if (setting_value[id] != value) {
+        setting_value[id] = value;
+        setting_dirty |= 1 << id;
+        // 重新计时，连续修改只在最后一次修改之后提交
+        esp_timer_stop(setting_timer);
+        esp_timer_start_once(setting_timer, STORAGE_SETTINGS_COMMIT_DELAY_MS * 1000);
+    }
+    xSemaphoreGive(setting_lock);
+}
+
+esp_err_t storage_settings_flush() {
+    if (setting_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(setting_lock, portMAX_DELAY);
+    uint32_t dirty = setting_dirty;
+    for (int i = 0; i < STORAGE_SETTING_MAX; i++) {
+        if (dirty & (1 << i)) {
+            storage_nvs_set_blob(setting_desc[i].key, &setting_value[i], setting_desc[i].size);
+        }
+    }
+    esp_err_t err = dirty ? storage_nvs_commit() : ESP_OK;
+    if (err == ESP_OK) {
+        setting_dirty = 0;
+    }
+    xSemaphoreGive(setting_lock);
+    if (dirty) {
+        ESP_LOGI(TAG, "commit settings 0x%lx: %s", dirty, esp_err_to_name(err));
+    }
+    return err;
+}
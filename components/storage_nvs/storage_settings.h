@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 修改后延迟提交的时间(ms)，期间的多次修改合并为一次 nvs_commit */
+#define STORAGE_SETTINGS_COMMIT_DELAY_MS 3000
+/** @brief 写入 NVS 的任务栈大小和优先级，定时器到期后由该任务提交 */
+#define STORAGE_SETTINGS_TASK_STACK (3 * 1024)
+#define STORAGE_SETTINGS_TASK_PRIORITY 2
+
+typedef enum {
+    STORAGE_SETTING_VOLUME = 0,  // 音量，key "volume"，1 字节
+    STORAGE_SETTING_MAX,
+} storage_setting_id_t;
+
+/**
+ * @brief 从 NVS 读取所有设置到内存
+ * @note 需要在 storage_nvs_init 之后调用，同时注册关机回调，重启(包括 OTA 完成后的重启)前写回未提交的设置
+ */
+void storage_settings_init();
+
+/**
+ * @brief 读取设置
+ * @param id 设置项
+ * @return 设置值，NVS 中没有时为默认值
+ * @note 只读内存，不访问 flash
+ */
+int32_t storage_settings_get(storage_setting_id_t id);
+
+/**
+ * @brief 修改设置
+ * @param id 设置项
+ * @param value 设置值
+ * @note 只修改内存并标记为脏，空闲 STORAGE_SETTINGS_COMMIT_DELAY_MS 后由写入任务统一写入 NVS
+ */
+void storage_settings_set(storage_setting_id_t id, int32_t value);
+
+/**
+ * @brief 立即把未提交的设置写入 NVS
+ * @return ESP_OK 成功
+ */
+esp_err_t storage_settings_flush();
@@ -0,0 +1,105 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+#include "qmsd_utils.h"
+#include "boot_stage.h"
+
+#define TAG "BOOT"
+
+#define BOOT_STAGE_ALL (BOOT_STAGE_BIT(BOOT_STAGE_MAX) - 1)
+
+typedef struct {
+    boot_stage_func_t func;
+    uint32_t deps;
+    uint32_t begin_ms;  // 从上电开始计时
+    uint32_t done_ms;
+} boot_stage_info_t;
+
+static const char* const stage_names[BOOT_STAGE_MAX] = {
+    [BOOT_STAGE_NVS] = "nvs",
+    [BOOT_STAGE_GX8006] = "gx8006",
+    [BOOT_STAGE_LITTLEFS] = "littlefs",
+    [BOOT_STAGE_AUDIO] = "audio",
+    [BOOT_STAGE_NOTIFY] = "notify",
+    [BOOT_STAGE_WIFI] = "wifi",
+    [BOOT_STAGE_PROMPT] = "prompt",
+    [BOOT_STAGE_CHAT] = "chat",
+};
+
+static EventGroupHandle_t stage_group;
+static boot_stage_info_t stage_info[BOOT_STAGE_MAX];
+
+void boot_stage_init(void) {
+    if (stage_group) {
+        return;
+    }
+    stage_group = xEventGroupCreate();
+}
+
+void boot_stage_begin(boot_stage_t stage) {
+    if (stage < BOOT_STAGE_MAX && stage_info[stage].begin_ms == 0) {
+        stage_info[stage].begin_ms = esp_timer_get_time() / 1000;
+    }
+}
+
+void boot_stage_done(boot_stage_t stage) {
+    if (stage >= BOOT_STAGE_MAX || stage_group == NULL) {
+        return;
+    }
+    boot_stage_begin(stage);
+    stage_info[stage].done_ms = esp_timer_get_time() / 1000;
+    ESP_LOGI(TAG, "%s done at %lu ms", stage_names[stage], stage_info[stage].done_ms);
+    EventBits_t bits = xEventGroupSetBits(stage_group, BOOT_STAGE_BIT(stage));
+    if ((bits & BOOT_STAGE_ALL) == BOOT_STAGE_ALL) {
+        boot_stage_print();
+    }
+}
+
+bool boot_stage_wait(uint32_t stages, uint32_t timeout_ms) {
+    if (stage_group == NULL) {
+        return false;
+    }
+    TickType_t ticks = timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    EventBits_t bits = xEventGroupWaitBits(stage_group, stages, pdFALSE, pdTRUE, ticks);
+    return (bits & stages) == stages;
+}
+
+static void boot_stage_task(void* arg) {
+    boot_stage_t stage = (boot_stage_t)(uintptr_t)arg;
+    boot_stage_info_t* info = &stage_info[stage];
+    if (info->deps) {
+        boot_stage_wait(info->deps, portMAX_DELAY);
+    }
+    boot_stage_begin(stage);
+    info->func();
+    boot_stage_done(stage);
+    vTaskDelete(NULL);
+}
+
+void boot_stage_run(boot_stage_t stage, boot_stage_func_t func, uint32_t deps, uint32_t stack) {
+    if (stage >= BOOT_STAGE_MAX || func == NULL) {
+        return;
+    }
+    stage_info[stage].func = func;
+    stage_info[stage].deps = deps;
+    qmsd_thread_create(boot_stage_task, stage_names[stage], stack, (void*)(uintptr_t)stage, 5, NULL, 0, 0);
+}
+
+void boot_stage_print(void) {
+    printf("boot timeline (ms):\n");
+    printf("  %-10s %8s %8s %8s\n", "stage", "begin", "done", "cost");
+    for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+        const boot_stage_info_t* info = &stage_info[i];
+        if (info->done_ms == 0) {
+            printf("  %-10s %8s %8s %8s\n", stage_names[i], "-", "-", "-");
+            continue;
+        }
+        printf("  %-10s %8lu %8lu %8lu\n", stage_names[i], info->begin_ms, info->done_ms,
+               info->done_ms - info->begin_ms);
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief 启动阶段
+ * @note 各阶段按依赖关系并行完成，完成时间记录在启动时间线中
+ */
+typedef enum {
+    BOOT_STAGE_NVS = 0,     // NVS 及配置读取
+    BOOT_STAGE_GX8006,      // 语音芯片启动完成，可以唤醒
+    BOOT_STAGE_LITTLEFS,    // 资源分区挂载及 TTS 缓存索引加载
+    BOOT_STAGE_AUDIO,       // 音频硬件及播放器
+    BOOT_STAGE_NOTIFY,      // 提示音模块，可以播放提示音
+    BOOT_STAGE_WIFI,        // Wi-Fi 已连接并获取 IP
+    BOOT_STAGE_PROMPT,      // 已播放联网成功提示音
+    BOOT_STAGE_CHAT,        // 对话服务已启动
+    BOOT_STAGE_MAX,
+} boot_stage_t;
+
+/** @brief 阶段对应的位，用于组合依赖 */
+#define BOOT_STAGE_BIT(stage) (1UL << (stage))
+
+/** @brief 阶段执行函数 */
+typedef void (*boot_stage_func_t)(void);
+
+/**
+ * @brief 初始化启动阶段记录
+ * @note 需要在 app_main 最开始调用
+ */
+void boot_stage_init(void);
+
+/**
+ * @brief 记录阶段开始时间
+ * @param stage 阶段
+ */
+void boot_stage_begin(boot_stage_t stage);
+
+/**
+ * @brief 标记阶段完成，唤醒等待该阶段的任务
+ * @param stage 阶段
+ * @note 所有阶段完成后自动打印启动时间线
+ */
+void boot_stage_done(boot_stage_t stage);
+
+/**
+ * @brief 等待多个阶段全部完成
+ * @param stages BOOT_STAGE_BIT 组合
+ * @param timeout_ms 超时时间
+ * @return true 全部完成，false 超时
+ */
+bool boot_stage_wait(uint32_t stages, uint32_t timeout_ms);
+
+/**
+ * @brief 在独立任务中执行一个阶段
+ * @param stage 阶段
+ * @param func 执行函数
+ * @param deps 依赖的阶段(BOOT_STAGE_BIT 组合)，全部完成后才执行
+ * @param stack 任务栈大小
+ * @note 执行完成后自动标记阶段完成并删除任务
+ */
+void boot_stage_run(boot_stage_t stage, boot_stage_func_t func, uint32_t deps, uint32_t stack);
+
+/**
+ * @brief 打印启动时间线
+ * @note 时间从上电开始计算，未完成的阶段显示为 -
+ */
+void boot_stage_print(void);
@@ -5,20 +5,28 @@
 #include "audio_player_user.h"
 #include "chat_asr_ctrl.h"
 #include "chat_notify.h"
+#include "chat_phrase.h"
+#include "chat_player.h"
+#include "chat_preroll.h"
 #include "esp_log.h"
 #include "gx8006.h"
 #include "qmsd_ota.h"
 #include "qmsd_utils.h"
+#include "qmsd_wifi_ps.h"
 #include "qmsd_wifi_sta.h"
+#include "tts_cache.h"
 
 #define TAG "aiha.ai_chat"
 
 static bool use_exit_chat_mode = false;
+static bool audio_upload_active = false;   // 已调用 aiha_websocket_audio_upload_start
+static bool audio_upload_pending = false;  // 唤醒词窗口内收到的 START，等窗口结束再开始上传
 
 #define AIHA_USED_DOUBAO_OPUS 0
 
 void aiha_websocket_audio_recv_cb(const uint8_t* data, uint32_t size, allinone_audio_status_t status, aiha_audio_format_t format) {
     if (status == ALLINONE_AUDIO_STATUS_START) {
+        chat_player_abort_stream();
         if (format == AIHA_AUDIO_FORMAT_MP3) {
             audio_player_play_url(MP3_URL_FROM_RAW, 1);
         } else if (format == AIHA_AUDIO_FORMAT_OPUS) {
@@ -45,7 +53,10 @@ bool aiha_audio_asr_finish(const char* quest, const char* answer_replace) {
     bool ret = chat_asr_ctrl_deal_asr_result(quest, data_answer);
     if (ret) {
         aiha_websocket_req_stop_all_async();
-        aiha_request_tts_async(data_answer);
+        // 本地拼接的回答优先用短语片段播放，片段未就绪时再走 TTS 缓存
+        if (chat_phrase_play(data_answer) == false) {
+            tts_cache_play(data_answer);
+        }
     }
     qmsd_free(data_answer);
     return true;
@@ -68,6 +79,11 @@ void aiha_chat_deal_error(allinone_error_code_t error_code) {
 }
 
 void aiha_audio_recv_callback(gx8006_audio_status_t status, uint8_t* data, uint32_t len) {
+    // 唤醒后马上退出 Wi-Fi 省电，第一个上行包和服务器响应不用等 DTIM
+    if (status == GX8006_AUDIO_WAKEUP) {
+        qmsd_wifi_ps_active();
+    }
+
 #if AIHA_USED_DOUBAO_OPUS
     // 8006，关闭vad的时候，没有start信号，而且唤醒后会有end，所以要忽略
     if (status == GX8006_AUDIO_START || status == GX8006_AUDIO_END) {
@@ -106,10 +122,13 @@ void aiha_audio_recv_callback(gx8006_audio_status_t status, uint8_t* data, uint3
         // 如果正在播放音乐，停止播放
         if (aiha_websocket_is_music_playing()) {
             ESP_LOGW(TAG, "wakeup interrupt during music playing, stop music");
-            audio_player_stop_speak();
+            chat_player_stop();
             aiha_websocket_set_music_playing(false);
         }
         aiha_websocket_set_wakeup();
+        chat_preroll_reset();
+        audio_upload_active = false;
+        audio_upload_pending = false;
         uint8_t random_num = rand() % 3;
         if (random_num == 0) {
             chat_notify_audio_play(NOTIFY_CHAT_WAKEUP_VC, NULL);
@@ -124,6 +143,9 @@ void aiha_audio_recv_callback(gx8006_audio_status_t status, uint8_t* data, uint3
 
     // 睡眠处理
     if (status == GX8006_AUDIO_SLEEP) {
+        chat_preroll_reset();
+        audio_upload_active = false;
+        audio_upload_pending = false;
         chat_notify_audio_play(NOTIFY_CHAT_EXIT, NULL);
         aiha_websocket_req_stop_all_async();
         if (use_exit_chat_mode) {
@@ -141,13 +163,37 @@ void aiha_audio_recv_callback(gx8006_audio_status_t status, uint8_t* data, uint3
 
     // 正常的VAD音频处理
     // 忽略唤醒词，有可能唤醒词的音频在wakeup事件后200ms才发送
-    if (status == GX8006_AUDIO_START && gx8006_get_wakeup_keep_ms() > 500) {
-        audio_player_stop_speak();
-        aiha_websocket_audio_upload_start();
+    // 唤醒词窗口内的 START 不丢弃，先缓存音频，窗口结束后再开始上传并补发预录音频
+    uint32_t keep_ms = gx8006_get_wakeup_keep_ms();
+    if (status == GX8006_AUDIO_START) {
+        if (keep_ms > 500) {
+            chat_player_stop();
+            aiha_websocket_audio_upload_start();
+            chat_preroll_flush(aiha_websocket_audio_upload_data, CHAT_PREROLL_SKIP_MS);
+            audio_upload_active = true;
+        } else {
+            audio_upload_pending = true;
+        }
     } else if (status == GX8006_AUDIO_END) {
-        aiha_websocket_audio_upload_end();
+        if (audio_upload_active) {
+            aiha_websocket_audio_upload_end();
+        }
+        chat_preroll_reset();
+        audio_upload_active = false;
+        audio_upload_pending = false;
     } else if (status == GX8006_AUDIO_RUNNING) {
-        aiha_websocket_audio_upload_data(data, len);
+        if (audio_upload_active || AIHA_USED_DOUBAO_OPUS) {
+            aiha_websocket_audio_upload_data(data, len);
+        } else {
+            chat_preroll_push(data, len, keep_ms);
+            if (audio_upload_pending && keep_ms > 500) {
+                chat_player_stop();
+                aiha_websocket_audio_upload_start();
+                chat_preroll_flush(aiha_websocket_audio_upload_data, CHAT_PREROLL_SKIP_MS);
+                audio_upload_active = true;
+                audio_upload_pending = false;
+            }
+        }
     }
 
     if (status == GX8006_AUDIO_FULL_FRAME) {
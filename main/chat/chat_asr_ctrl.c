@@ -2,8 +2,9 @@
 #include "aiha_websocket.h"
 #include "audio_hardware.h"
 #include "audio_player_user.h"
-#include "cmd_match.h"
+#include "chat_cmd.h"
 #include "esp_log.h"
+#include "storage_settings.h"
 
 /** @brief 问题字符串的最大长度 */
 #define AI_QUEST_STRING_SIZE 128
@@ -29,6 +30,8 @@ static bool cmd_vol_cb(const char* id, command_result_t cmd_result, char* answer
         return false;
     }
 
+    // 写回缓存，连续调节只在停止调节后写一次 flash
+    storage_settings_set(STORAGE_SETTING_VOLUME, audio_hardware_get_volume());
     sprintf(answer, "音量已设置为 %d", audio_hardware_get_volume());
     return true;
 }
@@ -41,7 +44,7 @@ static bool cmd_exit_cb(const char* id, command_result_t cmd_result, char* answe
 }
 
 bool chat_asr_ctrl_deal_asr_result(const char* asr_result, char* answer) {
-    bool ret = cmd_deal_with_string(asr_result, answer, AI_RSP_STRING_SIZE);
+    bool ret = chat_cmd_deal(asr_result, answer, AI_RSP_STRING_SIZE);
     if (ret) {
         ESP_LOGI(TAG, "asr finish, asr_result: %s, answer: %s", asr_result, answer);
     }
@@ -58,7 +61,7 @@ void chat_asr_ctrl_init() {
         .rules = CMD_RULES_VALUE,
         .cb = cmd_vol_cb,
     };
-    cmd_deal_register(&cmd_vol);
+    chat_cmd_register(&cmd_vol);
 
     cmd_deal_register_t cmd_quit = {
         .id = "quit",
@@ -69,5 +72,5 @@ void chat_asr_ctrl_init() {
         .rules = CMD_RULES_PART,
         .cb = cmd_exit_cb,
     };
-    cmd_deal_register(&cmd_quit);
+    chat_cmd_register(&cmd_quit);
 }
@@ -0,0 +1,262 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "chat_cmd.h"
+#include "chat_number.h"
+#include "chat_pinyin.h"
+#include "qmsd_utils.h"
+
+#define TAG "chat.cmd"
+
+#define CHAT_CMD_NONE 0xffff
+
+// 自动机节点，子节点用 child/sibling 链表保存，按字节转移
+typedef struct {
+    uint16_t child;    // 第一个子节点，0 表示没有(0 为根节点，不会是子节点)
+    uint16_t sibling;  // 下一个兄弟节点
+    uint16_t fail;     // 失配后跳转的节点
+    uint16_t out;      // 沿失配链最近的一个关键词结尾节点，CHAT_CMD_NONE 表示没有
+    uint16_t word;     // 以该节点结尾的第一个关键词，CHAT_CMD_NONE 表示没有
+    uint8_t byte;
+} chat_cmd_node_t;
+
+// 关键词，相同的关键词通过 next 串起来
+typedef struct {
+    uint8_t cmd;
+    uint8_t keyword;
+    uint16_t next;
+} chat_cmd_word_t;
+
+static cmd_deal_register_t cmd_list[CHAT_CMD_MAX];
+static uint8_t cmd_num = 0;
+static chat_cmd_node_t* cmd_nodes;
+static chat_cmd_word_t* cmd_words;
+
+static uint16_t chat_cmd_goto(const chat_cmd_node_t* nodes, uint16_t node, uint8_t byte) {
+    for (uint16_t child = nodes[node].child; child != 0; child = nodes[child].sibling) {
+        if (nodes[child].byte == byte) {
+            return child;
+        }
+    }
+    return 0;
+}
+
+static bool chat_cmd_build(void) {
+    uint32_t node_max = 1;
+    uint32_t word_num = 0;
+    for (int i = 0; i < cmd_num; i++) {
+        for (int j = 0; j < cmd_list[i].keyword_num; j++) {
+            node_max += strlen(cmd_list[i].keyword[j]);
+            word_num += 1;
+        }
+    }
+    if (node_max >= CHAT_CMD_NONE) {
+        return false;
+    }
+
+    chat_cmd_node_t* nodes = qmsd_malloc(node_max * sizeof(chat_cmd_node_t));
+    chat_cmd_word_t* words = qmsd_malloc((word_num ? word_num : 1) * sizeof(chat_cmd_word_t));
+    uint16_t* queue = qmsd_malloc(node_max * sizeof(uint16_t));
+    if (nodes == NULL || words == NULL || queue == NULL) {
+        qmsd_free(nodes);
+        qmsd_free(words);
+        qmsd_free(queue);
+        return false;
+    }
+    memset(nodes, 0, node_max * sizeof(chat_cmd_node_t));
+    nodes[0].out = CHAT_CMD_NONE;
+    nodes[0].word = CHAT_CMD_NONE;
+
+    // 1. 所有关键词插入字典树
+    uint16_t node_num = 1;
+    uint16_t word_index = 0;
+    for (int i = 0; i < cmd_num; i++) {
+        for (int j = 0; j < cmd_list[i].keyword_num; j++) {
+            uint16_t node = 0;
+            for (const uint8_t* p = (const uint8_t*)cmd_list[i].keyword[j]; *p; p++) {
+                uint16_t next = chat_cmd_goto(nodes, node, *p);
+                if (next == 0) {
+                    next = node_num++;
+                    nodes[next].byte = *p;
+                    nodes[next].out = CHAT_CMD_NONE;
+                    nodes[next].word = CHAT_CMD_NONE;
+                    nodes[next].sibling = nodes[node].child;
+                    nodes[node].child = next;
+                }
+                node = next;
+            }
+            if (node == 0) {
+                // 空关键词不参与匹配
+                continue;
+            }
+            words[word_index].cmd = i;
+            words[word_index].keyword = j;
+            words[word_index].next = CHAT_CMD_NONE;
+            // 相同关键词按注册顺序追加到末尾
+            uint16_t* tail = &nodes[node].word;
+            while (*tail != CHAT_CMD_NONE) {
+                tail = &words[*tail].next;
+            }
+            *tail = word_index++;
+        }
+    }
+
+    // 2. 按层次遍历生成失配指针和输出链
+    uint16_t head = 0;
+    uint16_t tail = 0;
+    for (uint16_t child = nodes[0].child; child != 0; child = nodes[child].sibling) {
+        nodes[child].fail = 0;
+        queue[tail++] = child;
+    }
+    while (head < tail) {
+        uint16_t node = queue[head++];
+        for (uint16_t child = nodes[node].child; child != 0; child = nodes[child].sibling) {
+            uint16_t fail = nodes[node].fail;
+            uint16_t next = chat_cmd_goto(nodes, fail, nodes[child].byte);
+            while (next == 0 && fail != 0) {
+                fail = nodes[fail].fail;
+                next = chat_cmd_goto(nodes, fail, nodes[child].byte);
+            }
+            nodes[child].fail = next;
+            nodes[child].out = nodes[next].word != CHAT_CMD_NONE ? next : nodes[next].out;
+            queue[tail++] = child;
+        }
+    }
+    qmsd_free(queue);
+
+    // 3. 关键词拼音索引，用于同音字纠错。只收录数值命令，纠错后还要能提取到数值或方向才会执行；
+    //    部分匹配的命令(如"退出")纠错后没有别的约束，"推出"这类普通说法会被误判
+    chat_pinyin_index_reset();
+    for (int i = 0; i < cmd_num; i++) {
+        if (cmd_list[i].rules != CMD_RULES_VALUE) {
+            continue;
+        }
+        for (int j = 0; j < cmd_list[i].keyword_num; j++) {
+            if (chat_pinyin_index_add(cmd_list[i].keyword[j], (i << 8) | j) == false) {
+                ESP_LOGW(TAG, "keyword %s exact match only", cmd_list[i].keyword[j]);
+            }
+        }
+    }
+
+    qmsd_free(cmd_nodes);
+    qmsd_free(cmd_words);
+    cmd_nodes = nodes;
+    cmd_words = words;
+    ESP_LOGI(TAG, "automaton rebuilt, commands: %d, keywords: %d, nodes: %d", cmd_num, word_index, node_num);
+    return true;
+}
+
+bool chat_cmd_register(const cmd_deal_register_t* cmd_reg) {
+    if (cmd_reg == NULL || cmd_num >= CHAT_CMD_MAX || cmd_reg->keyword_num > CHAT_CMD_KEYWORD_MAX) {
+        return false;
+    }
+    cmd_list[cmd_num++] = *cmd_reg;
+    if (chat_cmd_build() == false) {
+        ESP_LOGE(TAG, "register %s failed", cmd_reg->id);
+        cmd_num -= 1;
+        return false;
+    }
+    return true;
+}
+
+// 记录以当前位置结尾的所有关键词
+static void chat_cmd_mark(uint16_t node, uint16_t* hit) {
+    for (; node != CHAT_CMD_NONE && node != 0; node = cmd_nodes[node].out) {
+        for (uint16_t word = cmd_nodes[node].word; word != CHAT_CMD_NONE; word = cmd_words[word].next) {
+            hit[cmd_words[word].cmd] |= 1 << cmd_words[word].keyword;
+        }
+    }
+}
+
+// 用命令 cmd 的第 keyword 个关键词匹配文本，返回 -1 表示不匹配，否则为命令回调的返回值
+// fuzzy 为 true 时关键词由拼音纠错得到(从 keyword_start 开始)，关键词后面必须紧跟数值或方向词
+static int chat_cmd_try(int cmd, int keyword, const char* text_in, int keyword_start, char* answer,
+                        uint32_t answer_len, bool fuzzy) {
+    const cmd_deal_register_t* reg = &cmd_list[cmd];
+    // 数值命令先用本地解析器提取关键词之后的数值，解析不到(如"调大"、"最大")再交给 cmd_deal
+    command_result_t result = { 0 };
+    const char* keyword_pos = fuzzy ? text_in + keyword_start : strstr(text_in, reg->keyword[keyword]);
+    const char* keyword_end = keyword_pos ? keyword_pos + strlen(reg->keyword[keyword]) : NULL;
+    if (reg->rules != CMD_RULES_VALUE || keyword_pos == NULL ||
+        chat_number_parse(text_in, keyword_pos - text_in, keyword_end - text_in, reg->dir_up_words,
+                          reg->dir_down_words, &result) == false) {
+        // 纠错出的关键词可能是普通词中的同音字(如"先生音乐"中的"生音")，后面不是方向词时不交给 cmd_deal
+        if (fuzzy && (keyword_pos == NULL ||
+                      chat_number_dir_follows(keyword_end, reg->dir_up_words, reg->dir_down_words) == false)) {
+            return -1;
+        }
+        result = cmd_deal(text_in, reg->keyword[keyword], reg->dir_up_words, reg->dir_down_words, reg->rules);
+    }
+    if (result.result == CMD_MATCH_NONE || (fuzzy && result.result != CMD_MATCH_VALUE_OR_DIR)) {
+        return -1;
+    }
+    ESP_LOGI(TAG, "match %s, keyword: %s", reg->id, reg->keyword[keyword]);
+    return reg->cb ? reg->cb(reg->id, result, answer, answer_len) : 0;
+}
+
+// 返回 -1 表示没有命令匹配，否则为命令回调的返回值
+static int chat_cmd_dispatch(const char* text_in, char* answer, uint32_t answer_len) {
+    // hit[i] 的第 j 位表示命令 i 的第 j 个关键词出现在文本中
+    uint16_t hit[CHAT_CMD_MAX] = { 0 };
+    bool any = false;
+    uint16_t node = 0;
+    for (const uint8_t* p = (const uint8_t*)text_in; *p; p++) {
+        uint16_t next = chat_cmd_goto(cmd_nodes, node, *p);
+        while (next == 0 && node != 0) {
+            node = cmd_nodes[node].fail;
+            next = chat_cmd_goto(cmd_nodes, node, *p);
+        }
+        node = next;
+        if (cmd_nodes[node].word != CHAT_CMD_NONE || cmd_nodes[node].out != CHAT_CMD_NONE) {
+            chat_cmd_mark(cmd_nodes[node].word != CHAT_CMD_NONE ? node : cmd_nodes[node].out, hit);
+            any = true;
+        }
+    }
+    if (any == false) {
+        return -1;
+    }
+
+    for (int i = 0; i < cmd_num; i++) {
+        for (int j = 0; j < cmd_list[i].keyword_num; j++) {
+            if ((hit[i] & (1 << j)) == 0) {
+                continue;
+            }
+            int ret = chat_cmd_try(i, j, text_in, 0, answer, answer_len, false);
+            if (ret >= 0) {
+                return ret;
+            }
+        }
+    }
+    return -1;
+}
+
+bool chat_cmd_deal(const char* text_in, char* answer, uint32_t answer_len) {
+    if (text_in == NULL || cmd_nodes == NULL) {
+        return false;
+    }
+    int ret = chat_cmd_dispatch(text_in, answer, answer_len);
+    if (ret >= 0) {
+        return ret;
+    }
+
+    // 没有精确命中时按拼音查找同音/近音关键词，把文本中对应的字替换为关键词后再匹配一次
+    uint16_t tag, start, end;
+    if (chat_pinyin_find(text_in, &tag, &start, &end) == false) {
+        return false;
+    }
+    const char* keyword = cmd_list[tag >> 8].keyword[tag & 0xff];
+    char text_fixed[CHAT_CMD_TEXT_MAX];
+    uint32_t keyword_len = strlen(keyword);
+    uint32_t tail_len = strlen(text_in + end);
+    if (start + keyword_len + tail_len >= sizeof(text_fixed) ||
+        (end - start == keyword_len && memcmp(text_in + start, keyword, keyword_len) == 0)) {
+        return false;
+    }
+    memcpy(text_fixed, text_in, start);
+    memcpy(text_fixed + start, keyword, keyword_len);
+    memcpy(text_fixed + start + keyword_len, text_in + end, tail_len + 1);
+    ESP_LOGI(TAG, "fuzzy fixed: %s", text_fixed);
+    // 只用纠错出的这个关键词匹配，替换后的文本不再去碰其他命令
+    return chat_cmd_try(tag >> 8, tag & 0xff, text_fixed, start, answer, answer_len, true) > 0;
+}
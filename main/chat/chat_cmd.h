@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cmd_match.h"
+
+/** @brief 可注册的本地命令最大数量 */
+#define CHAT_CMD_MAX 32
+/** @brief 每个命令的关键词最大数量，与 cmd_deal_register_t.keyword 一致 */
+#define CHAT_CMD_KEYWORD_MAX 10
+/** @brief 拼音纠错后文本的最大长度 */
+#define CHAT_CMD_TEXT_MAX 256
+
+/**
+ * @brief 注册本地命令
+ * @param cmd_reg 命令描述，内容会被拷贝，但其中的字符串指针指向的内容不能被释放
+ * @return true 成功，false 数量已满或内存不足
+ * @note 每次注册都会重新生成全部关键词的 Aho-Corasick 自动机，只在初始化阶段调用
+ */
+bool chat_cmd_register(const cmd_deal_register_t* cmd_reg);
+
+/**
+ * @brief 用已注册的命令匹配文本
+ * @param text_in ASR 文本
+ * @param answer 输出参数，命中命令的回答文本
+ * @param answer_len answer 缓冲长度
+ * @return 命中命令回调的返回值，未命中时返回 false
+ * @note 一次线性扫描找出文本中出现的所有关键词，只对出现了关键词的命令调用 cmd_deal 做规则和值提取，
+ *       耗时与注册的命令数量无关；命令按注册顺序优先。没有命中时按拼音(不带声调)做有界编辑距离匹配，
+ *       把同音误识别(如"音亮")替换为关键词后再匹配一次。拼音纠错只用于 CMD_RULES_VALUE 命令，
+ *       纠错出的关键词后面必须紧跟数值或方向词；部分匹配和完全匹配的命令(如"退出")只做精确匹配
+ */
+bool chat_cmd_deal(const char* text_in, char* answer, uint32_t answer_len);
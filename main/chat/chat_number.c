@@ -0,0 +1,301 @@
+#include <string.h>
+
+#include "chat_number.h"
+
+typedef enum {
+    NUMBER_TOKEN_DIGIT,    // 数字，value 为数值
+    NUMBER_TOKEN_UNIT,     // 十百千，value 为倍数
+    NUMBER_TOKEN_PERCENT,  // 百分之
+    NUMBER_TOKEN_HALF,     // 一半、半，value 为对应的百分比
+    NUMBER_TOKEN_UP,       // 相对调高
+    NUMBER_TOKEN_DOWN,     // 相对调低
+    NUMBER_TOKEN_TO,       // 设置为
+    NUMBER_TOKEN_FILLER,   // 数值前可以忽略的词
+    NUMBER_TOKEN_END,      // 数值后可以出现的语气词
+} number_token_type_t;
+
+typedef struct {
+    const char* text;
+    uint8_t len;
+    number_token_type_t type;
+    uint16_t value;
+} number_token_t;
+
+#define NUMBER_TOKEN(str, type, value) { str, sizeof(str) - 1, type, value }
+
+// 按顺序匹配，长的词放在前面："百分之"要在"百"之前，"调高"要在"调"之前，"一半"要在"一"之前
+static const number_token_t number_tokens[] = {
+    NUMBER_TOKEN("百分之", NUMBER_TOKEN_PERCENT, 0),
+    NUMBER_TOKEN("设置为", NUMBER_TOKEN_TO, 0),
+    NUMBER_TOKEN("设置成", NUMBER_TOKEN_TO, 0),
+    NUMBER_TOKEN("设置到", NUMBER_TOKEN_TO, 0),
+    NUMBER_TOKEN("一半", NUMBER_TOKEN_HALF, 50),
+    NUMBER_TOKEN("一下", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("调高", NUMBER_TOKEN_UP, 0),
+    NUMBER_TOKEN("调大", NUMBER_TOKEN_UP, 0),
+    NUMBER_TOKEN("提高", NUMBER_TOKEN_UP, 0),
+    NUMBER_TOKEN("增加", NUMBER_TOKEN_UP, 0),
+    NUMBER_TOKEN("加大", NUMBER_TOKEN_UP, 0),
+    NUMBER_TOKEN("调低", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("调小", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("降低", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("减小", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("减少", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("给我", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("帮我", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("稍微", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("设置", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("就行", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("就好", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("零", NUMBER_TOKEN_DIGIT, 0),
+    NUMBER_TOKEN("〇", NUMBER_TOKEN_DIGIT, 0),
+    NUMBER_TOKEN("一", NUMBER_TOKEN_DIGIT, 1),
+    NUMBER_TOKEN("幺", NUMBER_TOKEN_DIGIT, 1),
+    NUMBER_TOKEN("二", NUMBER_TOKEN_DIGIT, 2),
+    NUMBER_TOKEN("两", NUMBER_TOKEN_DIGIT, 2),
+    NUMBER_TOKEN("三", NUMBER_TOKEN_DIGIT, 3),
+    NUMBER_TOKEN("四", NUMBER_TOKEN_DIGIT, 4),
+    NUMBER_TOKEN("五", NUMBER_TOKEN_DIGIT, 5),
+    NUMBER_TOKEN("六", NUMBER_TOKEN_DIGIT, 6),
+    NUMBER_TOKEN("七", NUMBER_TOKEN_DIGIT, 7),
+    NUMBER_TOKEN("八", NUMBER_TOKEN_DIGIT, 8),
+    NUMBER_TOKEN("九", NUMBER_TOKEN_DIGIT, 9),
+    NUMBER_TOKEN("十", NUMBER_TOKEN_UNIT, 10),
+    NUMBER_TOKEN("百", NUMBER_TOKEN_UNIT, 100),
+    NUMBER_TOKEN("千", NUMBER_TOKEN_UNIT, 1000),
+    NUMBER_TOKEN("半", NUMBER_TOKEN_HALF, 50),
+    NUMBER_TOKEN("加", NUMBER_TOKEN_UP, 0),
+    NUMBER_TOKEN("减", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("降", NUMBER_TOKEN_DOWN, 0),
+    NUMBER_TOKEN("到", NUMBER_TOKEN_TO, 0),
+    NUMBER_TOKEN("为", NUMBER_TOKEN_TO, 0),
+    NUMBER_TOKEN("成", NUMBER_TOKEN_TO, 0),
+    NUMBER_TOKEN("调", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("设", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("改", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("再", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("请", NUMBER_TOKEN_FILLER, 0),
+    NUMBER_TOKEN("吧", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("了", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("啊", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("呀", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("哦", NUMBER_TOKEN_END, 0),
+    NUMBER_TOKEN("啦", NUMBER_TOKEN_END, 0),
+};
+
+// 可以出现在关键词和数值之间、数值之后的标点
+static const char* const number_puncts[] = { "，", "。", "！", "？", "、", "％" };
+
+static const number_token_t* chat_number_token(const char* text) {
+    for (int i = 0; i < sizeof(number_tokens) / sizeof(number_tokens[0]); i++) {
+        if (strncmp(text, number_tokens[i].text, number_tokens[i].len) == 0) {
+            return &number_tokens[i];
+        }
+    }
+    return NULL;
+}
+
+// 返回标点或空白的字节数，不是标点时返回 0。数字之间的 "." 是小数点，不算标点
+static uint8_t chat_number_punct(const char* text) {
+    if (*text == '.') {
+        return text[1] >= '0' && text[1] <= '9' ? 0 : 1;
+    }
+    if (*text == ' ' || *text == ',' || *text == '!' || *text == '?' || *text == '%') {
+        return 1;
+    }
+    for (int i = 0; i < sizeof(number_puncts) / sizeof(number_puncts[0]); i++) {
+        uint8_t len = strlen(number_puncts[i]);
+        if (strncmp(text, number_puncts[i], len) == 0) {
+            return len;
+        }
+    }
+    return 0;
+}
+
+// 注册的方向词，多个词用 "|" 或 "," 分隔，返回匹配的字节数
+static uint8_t chat_number_dir_word(const char* text, const char* words) {
+    while (words && *words) {
+        uint32_t len = strcspn(words, "|,");
+        if (len > 0 && strncmp(text, words, len) == 0) {
+            return len;
+        }
+        words += len + (words[len] != '\0');
+    }
+    return 0;
+}
+
+// 文本以方向词结尾时返回 1(调高)或 -1(调低)，否则返回 0
+static int chat_number_dir_before(const char* text, uint32_t len, const char* dir_up, const char* dir_down) {
+    for (int i = 0; i < sizeof(number_tokens) / sizeof(number_tokens[0]); i++) {
+        const number_token_t* token = &number_tokens[i];
+        if ((token->type == NUMBER_TOKEN_UP || token->type == NUMBER_TOKEN_DOWN) && len >= token->len &&
+            memcmp(text + len - token->len, token->text, token->len) == 0) {
+            return token->type == NUMBER_TOKEN_UP ? 1 : -1;
+        }
+    }
+    for (int sign = 1; sign >= -1; sign -= 2) {
+        const char* words = sign > 0 ? dir_up : dir_down;
+        while (words && *words) {
+            uint32_t word_len = strcspn(words, "|,");
+            if (word_len > 0 && len >= word_len && memcmp(text + len - word_len, words, word_len) == 0) {
+                return sign;
+            }
+            words += word_len + (words[word_len] != '\0');
+        }
+    }
+    return 0;
+}
+
+// 读取一个中文数值，返回读取的字节数，0 表示不是规范的数值
+static uint32_t chat_number_read_cn(const char* text, uint32_t* out) {
+    const char* p = text;
+    uint32_t section = 0;    // 已经乘过单位的部分
+    uint32_t digit = 0;      // 还没有遇到单位的数字
+    uint32_t last_unit = 0;  // 最近一个单位
+    bool has_digit = false;
+    bool zero = false;       // 单位后出现过"零"，如"一千零五"
+    bool any = false;
+
+    for (;;) {
+        const number_token_t* token = chat_number_token(p);
+        if (token == NULL || (token->type != NUMBER_TOKEN_DIGIT && token->type != NUMBER_TOKEN_UNIT)) {
+            break;
+        }
+        if (token->type == NUMBER_TOKEN_DIGIT) {
+            if (has_digit) {
+                // "七五" 这类连读不是规范的数值
+                return 0;
+            }
+            const number_token_t* next = chat_number_token(p + token->len);
+            if (strcmp(token->text, "两") == 0 && section != 0 && (next == NULL || next->type != NUMBER_TOKEN_UNIT)) {
+                // "五十两" 中的两是量词，不是个位
+                return 0;
+            }
+            if (token->value == 0) {
+                zero = any;
+            } else {
+                digit = token->value;
+                has_digit = true;
+            }
+        } else {
+            if (has_digit == false && section != 0) {
+                // "百十" 这类缺少数字的写法不识别
+                return 0;
+            }
+            // "十五" 省略了前面的 "一"
+            section += (has_digit ? digit : 1) * token->value;
+            last_unit = token->value;
+            digit = 0;
+            has_digit = false;
+            zero = false;
+        }
+        any = true;
+        p += token->len;
+    }
+    if (any == false) {
+        return 0;
+    }
+    // "三百五"、"一千二" 省略了末尾的单位，个位数字按上一个单位的下一级计算
+    if (has_digit && zero == false && last_unit >= 100) {
+        digit *= last_unit / 10;
+    }
+    *out = section + digit;
+    return p - text;
+}
+
+bool chat_number_dir_follows(const char* text, const char* dir_up, const char* dir_down) {
+    static const char* const extreme_words[] = { "最大", "最小", "最高", "最低" };
+    uint8_t len;
+    while ((len = chat_number_punct(text)) > 0 && *text != '%') {
+        text += len;
+    }
+    const number_token_t* token = chat_number_token(text);
+    if (token && (token->type == NUMBER_TOKEN_UP || token->type == NUMBER_TOKEN_DOWN)) {
+        return true;
+    }
+    for (int i = 0; i < sizeof(extreme_words) / sizeof(extreme_words[0]); i++) {
+        if (strncmp(text, extreme_words[i], strlen(extreme_words[i])) == 0) {
+            return true;
+        }
+    }
+    return chat_number_dir_word(text, dir_up) > 0 || chat_number_dir_word(text, dir_down) > 0;
+}
+
+bool chat_number_parse(const char* text, uint32_t keyword_start, uint32_t keyword_end, const char* dir_up,
+                       const char* dir_down, command_result_t* result) {
+    // 关键词前紧挨着的方向词，如"调高音量二十"
+    int sign = chat_number_dir_before(text, keyword_start, dir_up, dir_down);
+    const char* p = text + keyword_end;
+
+    // 1. 关键词和数值之间只允许方向词、"到/为/成"和少量口语填充词，出现其他内容时不在本地解析
+    for (;;) {
+        if (*p >= '0' && *p <= '9') {
+            break;
+        }
+        uint8_t len = chat_number_punct(p);
+        if (len > 0 && *p != '%') {
+            p += len;
+            continue;
+        }
+        const number_token_t* token = chat_number_token(p);
+        if (token && (token->type == NUMBER_TOKEN_DIGIT || token->type == NUMBER_TOKEN_UNIT ||
+                      token->type == NUMBER_TOKEN_HALF)) {
+            break;
+        }
+        if (token && token->type != NUMBER_TOKEN_END) {
+            if (token->type == NUMBER_TOKEN_UP || token->type == NUMBER_TOKEN_DOWN || token->type == NUMBER_TOKEN_TO) {
+                sign = token->type == NUMBER_TOKEN_UP ? 1 : (token->type == NUMBER_TOKEN_DOWN ? -1 : 0);
+            }
+            p += token->len;
+            continue;
+        }
+        if ((len = chat_number_dir_word(p, dir_up)) > 0) {
+            sign = 1;
+            p += len;
+            continue;
+        }
+        if ((len = chat_number_dir_word(p, dir_down)) > 0) {
+            sign = -1;
+            p += len;
+            continue;
+        }
+        return false;
+    }
+
+    // 2. 数值
+    uint32_t value = 0;
+    const number_token_t* token = chat_number_token(p);
+    if (*p >= '0' && *p <= '9') {
+        while (*p >= '0' && *p <= '9' && value < 10000) {
+            value = value * 10 + (*p++ - '0');
+        }
+    } else if (token && token->type == NUMBER_TOKEN_HALF) {
+        value = token->value;
+        p += token->len;
+    } else {
+        uint32_t len = chat_number_read_cn(p, &value);
+        if (len == 0) {
+            return false;
+        }
+        p += len;
+    }
+
+    // 3. 数值之后只允许百分号、标点和语气词。"点"(小数、时间)、"档"、"岁"、"成"、"个"等说明
+    //    这不是要设置的百分比数值，交给 cmd_deal 或云端处理
+    while (*p) {
+        uint8_t len = chat_number_punct(p);
+        if (len == 0) {
+            const number_token_t* end = chat_number_token(p);
+            if (end == NULL || end->type != NUMBER_TOKEN_END) {
+                return false;
+            }
+            len = end->len;
+        }
+        p += len;
+    }
+
+    result->result = CMD_MATCH_VALUE_OR_DIR;
+    result->dir = sign == 0 ? CMD_DIR_VALUE_EXACT : CMD_DIR_VALUE_MODIFY;
+    result->value = sign < 0 ? -(float)value : (float)value;
+    return true;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cmd_match.h"
+
+/**
+ * @brief 从命令关键词之后的文本中提取数值调整
+ * @param text ASR 文本(UTF-8)
+ * @param keyword_start 命中的关键词在 text 中的起始字节
+ * @param keyword_end 命中的关键词在 text 中的结束字节(不含)，从这里开始解析
+ * @param dir_up 注册的调高方向词，多个词用 "|" 或 "," 分隔，可以为 NULL
+ * @param dir_down 注册的调低方向词，格式同 dir_up
+ * @param result 输出参数，成功时 result 为 CMD_MATCH_VALUE_OR_DIR，
+ *               dir 为 CMD_DIR_VALUE_EXACT(设置为 value) 或 CMD_DIR_VALUE_MODIFY(调整 value，调低时为负数)
+ * @return true 提取到数值，false 关键词之后不是可以本地处理的数值(交给 cmd_deal 或云端)
+ * @note 查表单遍扫描，支持中文数字("七十五"、"两百"、口语的"三百五"、"一千二")、阿拉伯数字("50"、"50%")、
+ *       "百分之六十"、"一半"。关键词和数值之间只允许方向词、"到/为/成"和少量填充词，
+ *       数值之后只允许标点和语气词：小数、"点"、"档"、"岁"、"成"等都不在本地解析。
+ *       关键词前紧挨着方向词(如"调高音量二十")或数值前出现方向词时为相对调整，出现"到/为/成"时为设置
+ */
+bool chat_number_parse(const char* text, uint32_t keyword_start, uint32_t keyword_end, const char* dir_up,
+                       const char* dir_down, command_result_t* result);
+
+/**
+ * @brief 判断文本是否以方向词开头
+ * @param text 命令关键词之后的文本
+ * @param dir_up 注册的调高方向词，格式同 chat_number_parse
+ * @param dir_down 注册的调低方向词
+ * @return true 以"调高/调低/最大/最小"等方向词或注册的方向词开头(忽略标点)
+ * @note 用于拼音纠错：纠错出的关键词后面紧跟数值或方向词时才认为是命令
+ */
+bool chat_number_dir_follows(const char* text, const char* dir_up, const char* dir_down);
@@ -0,0 +1,190 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "chat_pinyin.h"
+#include "chat_pinyin_table.h"
+
+#define TAG "chat.pinyin"
+
+// 拼音表之外的字，不会与任何关键词字母相同
+#define CHAT_PINYIN_UNKNOWN '#'
+
+typedef struct {
+    uint16_t offset;       // 在 pinyin_pool 中的起始位置
+    uint8_t len;           // 拼音字母数
+    uint8_t max_distance;  // 允许的编辑距离
+    uint16_t tag;
+} chat_pinyin_index_t;
+
+static char pinyin_pool[CHAT_PINYIN_POOL_SIZE];
+static uint16_t pinyin_pool_used = 0;
+static chat_pinyin_index_t pinyin_index[CHAT_PINYIN_INDEX_MAX];
+static uint8_t pinyin_index_num = 0;
+
+// 解码一个 UTF-8 字符，返回字节数
+static uint8_t chat_pinyin_utf8_decode(const uint8_t* p, uint32_t* code) {
+    if (p[0] >= 0xe0 && p[0] < 0xf0 && (p[1] & 0xc0) == 0x80 && (p[2] & 0xc0) == 0x80) {
+        *code = ((p[0] & 0x0f) << 12) | ((p[1] & 0x3f) << 6) | (p[2] & 0x3f);
+        return 3;
+    }
+    *code = 0;
+    if (p[0] >= 0xf0) {
+        return (p[1] && p[2] && p[3]) ? 4 : 1;
+    } else if (p[0] >= 0xc0) {
+        return p[1] ? 2 : 1;
+    }
+    return 1;
+}
+
+// 二分查找拼音，不在表中返回 NULL
+static const char* chat_pinyin_lookup(uint32_t code) {
+    int low = 0;
+    int high = sizeof(chat_pinyin_table) / sizeof(chat_pinyin_table[0]) - 1;
+    while (low <= high) {
+        int mid = (low + high) / 2;
+        if (chat_pinyin_table[mid].code == code) {
+            return chat_pinyin_syllables[chat_pinyin_table[mid].syllable];
+        } else if (chat_pinyin_table[mid].code < code) {
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+    return NULL;
+}
+
+void chat_pinyin_index_reset(void) {
+    pinyin_pool_used = 0;
+    pinyin_index_num = 0;
+}
+
+bool chat_pinyin_index_add(const char* keyword, uint16_t tag) {
+    if (keyword == NULL || pinyin_index_num >= CHAT_PINYIN_INDEX_MAX) {
+        return false;
+    }
+    char letters[CHAT_PINYIN_KEYWORD_MAX];
+    uint8_t len = 0;
+    uint8_t chars = 0;
+    const uint8_t* p = (const uint8_t*)keyword;
+    while (*p) {
+        chars += 1;
+        uint32_t code;
+        p += chat_pinyin_utf8_decode(p, &code);
+        const char* syllable = chat_pinyin_lookup(code);
+        if (syllable == NULL || len + strlen(syllable) > CHAT_PINYIN_KEYWORD_MAX) {
+            return false;
+        }
+        memcpy(letters + len, syllable, strlen(syllable));
+        len += strlen(syllable);
+    }
+    if (len == 0 || pinyin_pool_used + len > CHAT_PINYIN_POOL_SIZE) {
+        return false;
+    }
+    memcpy(pinyin_pool + pinyin_pool_used, letters, len);
+    pinyin_index[pinyin_index_num].offset = pinyin_pool_used;
+    pinyin_index[pinyin_index_num].len = len;
+    // 两个字的关键词拼音很短，允许编辑后"因连"之类的普通词也能命中，只做同音匹配
+    pinyin_index[pinyin_index_num].max_distance = chars <= CHAT_PINYIN_EXACT_CHARS ? 0 : len / CHAT_PINYIN_LETTERS_PER_EDIT;
+    pinyin_index[pinyin_index_num].tag = tag;
+    pinyin_index_num += 1;
+    pinyin_pool_used += len;
+    return true;
+}
+
+// 近似子串匹配(Sellers)，返回最小编辑距离，同时给出匹配在 text 字母中的起止位置
+static uint8_t chat_pinyin_distance(const char* key, uint8_t m, const char* text, uint16_t n, uint16_t* start, uint16_t* end) {
+    uint8_t cost[CHAT_PINYIN_KEYWORD_MAX + 1];
+    uint16_t from[CHAT_PINYIN_KEYWORD_MAX + 1];  // 对应对齐在 text 中的起点
+    uint8_t best = 0xff;
+    for (int i = 0; i <= m; i++) {
+        cost[i] = i;
+        from[i] = 0;
+    }
+    for (uint16_t j = 1; j <= n; j++) {
+        // diag 为上一列的 cost[i - 1]，第 0 行任意位置都可以作为起点
+        uint8_t diag = 0;
+        uint16_t diag_from = j - 1;
+        cost[0] = 0;
+        from[0] = j;
+        for (int i = 1; i <= m; i++) {
+            uint8_t up = cost[i];
+            uint16_t up_from = from[i];
+            uint8_t value = diag + (key[i - 1] != text[j - 1]);
+            uint16_t value_from = diag_from;
+            if (cost[i - 1] + 1 < value) {
+                value = cost[i - 1] + 1;
+                value_from = from[i - 1];
+            }
+            if (up + 1 < value) {
+                value = up + 1;
+                value_from = up_from;
+            }
+            diag = up;
+            diag_from = up_from;
+            cost[i] = value;
+            from[i] = value_from;
+        }
+        if (cost[m] < best) {
+            best = cost[m];
+            *start = from[m];
+            *end = j;
+        }
+    }
+    return best;
+}
+
+bool chat_pinyin_find(const char* text, uint16_t* tag, uint16_t* start, uint16_t* end) {
+    if (text == NULL || pinyin_index_num == 0) {
+        return false;
+    }
+
+    // 文本转为拼音字母串，src 记录每个字母来自 text 的哪个字节
+    char letters[CHAT_PINYIN_TEXT_MAX * 2];
+    uint8_t src[CHAT_PINYIN_TEXT_MAX * 2];
+    uint16_t n = 0;
+    uint16_t pos = 0;
+    while (text[pos] && pos < CHAT_PINYIN_TEXT_MAX) {
+        uint32_t code;
+        uint8_t len = chat_pinyin_utf8_decode((const uint8_t*)text + pos, &code);
+        const char* syllable = chat_pinyin_lookup(code);
+        uint8_t syllable_len = syllable ? strlen(syllable) : 1;
+        if (n + syllable_len > sizeof(letters)) {
+            break;
+        }
+        for (int i = 0; i < syllable_len; i++) {
+            letters[n] = syllable ? syllable[i] : CHAT_PINYIN_UNKNOWN;
+            src[n++] = pos;
+        }
+        pos += len;
+    }
+
+    uint8_t best = 0xff;
+    for (int i = 0; i < pinyin_index_num; i++) {
+        const chat_pinyin_index_t* index = &pinyin_index[i];
+        uint16_t letter_start = 0;
+        uint16_t letter_end = 0;
+        uint8_t distance = chat_pinyin_distance(pinyin_pool + index->offset, index->len, letters, n, &letter_start, &letter_end);
+        if (distance > index->max_distance || distance >= best || letter_end <= letter_start) {
+            continue;
+        }
+        // 匹配必须从一个字的第一个字母开始、到一个字的最后一个字母结束，不接受半个字的拼音
+        if ((letter_start > 0 && src[letter_start - 1] == src[letter_start]) ||
+            (letter_end < n && src[letter_end] == src[letter_end - 1])) {
+            continue;
+        }
+        best = distance;
+        *tag = index->tag;
+        // 扩展到完整的字
+        uint16_t k = letter_end;
+        while (k < n && src[k] == src[letter_end - 1]) {
+            k++;
+        }
+        *start = src[letter_start];
+        *end = k < n ? src[k] : pos;
+    }
+    if (best != 0xff) {
+        ESP_LOGI(TAG, "fuzzy match tag: %04x, distance: %d, text: %.*s", *tag, best, *end - *start, text + *start);
+    }
+    return best != 0xff;
+}
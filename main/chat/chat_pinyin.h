@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief 参与拼音匹配的文本最大字节数，超出部分忽略 */
+#define CHAT_PINYIN_TEXT_MAX 128
+/** @brief 单个关键词拼音的最大字母数 */
+#define CHAT_PINYIN_KEYWORD_MAX 32
+/** @brief 拼音索引的关键词最大数量 */
+#define CHAT_PINYIN_INDEX_MAX 64
+/** @brief 拼音索引的字母池大小 */
+#define CHAT_PINYIN_POOL_SIZE 512
+/** @brief 每多少个拼音字母允许 1 个编辑距离，少于该长度的关键词只做同音匹配 */
+#define CHAT_PINYIN_LETTERS_PER_EDIT 8
+/** @brief 不超过该字数的关键词只做同音匹配，不允许编辑距离 */
+#define CHAT_PINYIN_EXACT_CHARS 2
+
+/**
+ * @brief 清空拼音索引
+ */
+void chat_pinyin_index_reset(void);
+
+/**
+ * @brief 把关键词的拼音加入索引
+ * @param keyword 关键词
+ * @param tag 命中时返回的标识
+ * @return true 成功，false 关键词中有拼音表之外的字、太长或索引已满(该关键词只做精确匹配)
+ * @note 拼音在注册时计算好，匹配时不再查表转换关键词
+ */
+bool chat_pinyin_index_add(const char* keyword, uint16_t tag);
+
+/**
+ * @brief 在文本中查找拼音相近的关键词
+ * @param text ASR 文本
+ * @param tag 输出参数，命中关键词的标识
+ * @param start 输出参数，命中部分在 text 中的起始字节
+ * @param end 输出参数，命中部分在 text 中的结束字节(不含)
+ * @return true 命中，false 没有拼音相近的关键词
+ * @note 在不带声调的拼音空间内做有界编辑距离匹配，同音字(如"音亮"与"音量")距离为 0；
+ *       两个字的关键词只接受同音，匹配必须落在完整的字上。多个关键词命中时取距离最小的，
+ *       全部使用栈上缓冲，不分配内存
+ */
+bool chat_pinyin_find(const char* text, uint16_t* tag, uint16_t* start, uint16_t* end);
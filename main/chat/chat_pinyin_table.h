@@ -0,0 +1,304 @@
+// 由 main/tools/mkpinyin.py 生成，不要手动修改
+#pragma once
+
+#include <stdint.h>
+
+static const char* const chat_pinyin_syllables[] = {
+    "an",
+    "bi",
+    "bo",
+    "bu",
+    "chu",
+    "da",
+    "deng",
+    "di",
+    "dian",
+    "duo",
+    "fang",
+    "gao",
+    "guan",
+    "ji",
+    "jing",
+    "kai",
+    "lian",
+    "liang",
+    "niang",
+    "shao",
+    "shen",
+    "sheng",
+    "shuo",
+    "tiao",
+    "ting",
+    "tui",
+    "xia",
+    "xiao",
+    "xie",
+    "xu",
+    "yao",
+    "yi",
+    "yin",
+    "ying",
+    "zai",
+    "zan",
+    "zhi",
+    "zhong",
+    "zui",
+};
+
+static const struct {
+    uint16_t code;
+    uint8_t syllable;
+} chat_pinyin_table[] = {
+    { 0x4e00, 31 },  // 一
+    { 0x4e0b, 26 },  // 下
+    { 0x4e0d, 3 },  // 不
+    { 0x4e24, 17 },  // 两
+    { 0x4e2d, 37 },  // 中
+    { 0x4e4b, 36 },  // 之
+    { 0x4e95, 14 },  // 井
+    { 0x4e9b, 28 },  // 些
+    { 0x4eac, 14 },  // 京
+    { 0x4eae, 17 },  // 亮
+    { 0x4ec0, 20 },  // 什
+    { 0x4ed4, 34 },  // 仔
+    { 0x4ee5, 31 },  // 以
+    { 0x4eff, 10 },  // 仿
+    { 0x4f17, 37 },  // 众
+    { 0x4f2f, 2 },  // 伯
+    { 0x4f38, 20 },  // 伸
+    { 0x4f4e, 7 },  // 低
+    { 0x4f9d, 31 },  // 依
+    { 0x4fa0, 26 },  // 侠
+    { 0x505c, 24 },  // 停
+    { 0x50a8, 4 },  // 储
+    { 0x5173, 12 },  // 关
+    { 0x5178, 8 },  // 典
+    { 0x518d, 34 },  // 再
+    { 0x5199, 28 },  // 写
+    { 0x51c9, 17 },  // 凉
+    { 0x51e0, 13 },  // 几
+    { 0x51ef, 15 },  // 凯
+    { 0x51fa, 4 },  // 出
+    { 0x521d, 4 },  // 初
+    { 0x5236, 36 },  // 制
+    { 0x5265, 2 },  // 剥
+    { 0x5269, 21 },  // 剩
+    { 0x52fa, 19 },  // 勺
+    { 0x533b, 31 },  // 医
+    { 0x5347, 21 },  // 升
+    { 0x534f, 28 },  // 协
+    { 0x535a, 2 },  // 博
+    { 0x535c, 3 },  // 卜
+    { 0x5370, 32 },  // 印
+    { 0x5373, 13 },  // 即
+    { 0x5385, 24 },  // 厅
+    { 0x53a8, 4 },  // 厨
+    { 0x53ea, 36 },  // 只
+    { 0x5413, 26 },  // 吓
+    { 0x541f, 32 },  // 吟
+    { 0x542c, 24 },  // 听
+    { 0x544a, 11 },  // 告
+    { 0x54ac, 30 },  // 咬
+    { 0x54b1, 35 },  // 咱
+    { 0x5634, 38 },  // 嘴
+    { 0x56e0, 32 },  // 因
+    { 0x5723, 21 },  // 圣
+    { 0x5728, 34 },  // 在
+    { 0x5730, 7 },  // 地
+    { 0x5883, 14 },  // 境
+    { 0x58c1, 1 },  // 壁
+    { 0x58f0, 21 },  // 声
+    { 0x5904, 4 },  // 处
+    { 0x590f, 26 },  // 夏
+    { 0x591a, 9 },  // 多
+    { 0x5927, 5 },  // 大
+    { 0x593a, 9 },  // 夺
+    { 0x5a18, 18 },  // 娘
+    { 0x5b89, 0 },  // 安
+    { 0x5b98, 12 },  // 官
+    { 0x5ba1, 20 },  // 审
+    { 0x5bb0, 34 },  // 宰
+    { 0x5bc5, 32 },  // 寅
+    { 0x5c0f, 27 },  // 小
+    { 0x5c11, 19 },  // 少
+    { 0x5cb8, 0 },  // 岸
+    { 0x5ce1, 26 },  // 峡
+    { 0x5df2, 31 },  // 已
+    { 0x5e01, 1 },  // 币
+    { 0x5e03, 3 },  // 布
+    { 0x5e8f, 29 },  // 序
+    { 0x5e94, 33 },  // 应
+    { 0x5e95, 7 },  // 底
+    { 0x5e97, 8 },  // 店
+    { 0x5ead, 24 },  // 庭
+    { 0x5f00, 15 },  // 开
+    { 0x5f15, 32 },  // 引
+    { 0x5f1f, 7 },  // 弟
+    { 0x5f71, 33 },  // 影
+    { 0x5f7c, 1 },  // 彼
+    { 0x5fc5, 1 },  // 必
+    { 0x6025, 13 },  // 急
+    { 0x604b, 16 },  // 恋
+    { 0x60ef, 12 },  // 惯
+    { 0x610f, 31 },  // 意
+    { 0x6168, 15 },  // 慨
+    { 0x623f, 10 },  // 房
+    { 0x6253, 5 },  // 打
+    { 0x6280, 13 },  // 技
+    { 0x62e8, 2 },  // 拨
+    { 0x6307, 36 },  // 指
+    { 0x6309, 0 },  // 按
+    { 0x6311, 23 },  // 挑
+    { 0x633a, 24 },  // 挺
+    { 0x6355, 3 },  // 捕
+    { 0x63a8, 25 },  // 推
+    { 0x641e, 11 },  // 搞
+    { 0x642d, 5 },  // 搭
+    { 0x6447, 30 },  // 摇
+    { 0x64ad, 2 },  // 播
+    { 0x6512, 35 },  // 攒
+    { 0x653e, 10 },  // 放
+    { 0x6548, 27 },  // 效
+    { 0x654c, 7 },  // 敌
+    { 0x65b9, 10 },  // 方
+    { 0x6613, 31 },  // 易
+    { 0x6620, 33 },  // 映
+    { 0x6653, 27 },  // 晓
+    { 0x666f, 14 },  // 景
+    { 0x667e, 17 },  // 晾
+    { 0x6682, 35 },  // 暂
+    { 0x6697, 0 },  // 暗
+    { 0x6700, 38 },  // 最
+    { 0x6714, 22 },  // 朔
+    { 0x6735, 9 },  // 朵
+    { 0x673a, 13 },  // 机
+    { 0x6761, 23 },  // 条
+    { 0x6781, 13 },  // 极
+    { 0x6821, 27 },  // 校
+    { 0x6848, 0 },  // 案
+    { 0x6881, 17 },  // 梁
+    { 0x695a, 4 },  // 楚
+    { 0x6a31, 33 },  // 樱
+    { 0x6b62, 36 },  // 止
+    { 0x6b65, 3 },  // 步
+    { 0x6bb7, 32 },  // 殷
+    { 0x6bd4, 1 },  // 比
+    { 0x6bd5, 1 },  // 毕
+    { 0x6ce2, 2 },  // 波
+    { 0x6d88, 27 },  // 消
+    { 0x6df1, 20 },  // 深
+    { 0x6ef4, 7 },  // 滴
+    { 0x704c, 12 },  // 灌
+    { 0x706f, 6 },  // 灯
+    { 0x707e, 34 },  // 灾
+    { 0x70b9, 8 },  // 点
+    { 0x70c1, 22 },  // 烁
+    { 0x70e7, 19 },  // 烧
+    { 0x7272, 21 },  // 牲
+    { 0x751a, 20 },  // 甚
+    { 0x751f, 21 },  // 生
+    { 0x7535, 8 },  // 电
+    { 0x767b, 6 },  // 登
+    { 0x76f4, 36 },  // 直
+    { 0x7701, 21 },  // 省
+    { 0x778e, 26 },  // 瞎
+    { 0x77aa, 6 },  // 瞪
+    { 0x77e5, 36 },  // 知
+    { 0x7840, 4 },  // 础
+    { 0x7855, 22 },  // 硕
+    { 0x786c, 33 },  // 硬
+    { 0x795e, 20 },  // 神
+    { 0x79cd, 37 },  // 种
+    { 0x7a0d, 19 },  // 稍
+    { 0x7a3f, 11 },  // 稿
+    { 0x7b11, 27 },  // 笑
+    { 0x7b14, 1 },  // 笔
+    { 0x7b2c, 7 },  // 第
+    { 0x7b49, 6 },  // 等
+    { 0x7b54, 5 },  // 答
+    { 0x7ba1, 12 },  // 管
+    { 0x7cae, 17 },  // 粮
+    { 0x7cbe, 14 },  // 精
+    { 0x7cd5, 11 },  // 糕
+    { 0x7ea7, 13 },  // 级
+    { 0x7ec3, 16 },  // 练
+    { 0x7ec8, 37 },  // 终
+    { 0x7ecf, 14 },  // 经
+    { 0x7ee7, 13 },  // 继
+    { 0x7eed, 29 },  // 续
+    { 0x7ef3, 21 },  // 绳
+    { 0x7f6a, 38 },  // 罪
+    { 0x8000, 30 },  // 耀
+    { 0x8054, 16 },  // 联
+    { 0x80be, 20 },  // 肾
+    { 0x80dc, 21 },  // 胜
+    { 0x8138, 16 },  // 脸
+    { 0x8170, 30 },  // 腰
+    { 0x817f, 25 },  // 腿
+    { 0x81f3, 36 },  // 至
+    { 0x826f, 17 },  // 良
+    { 0x82f1, 33 },  // 英
+    { 0x836f, 30 },  // 药
+    { 0x83b2, 16 },  // 莲
+    { 0x83b9, 33 },  // 莹
+    { 0x8425, 33 },  // 营
+    { 0x865a, 29 },  // 虚
+    { 0x867e, 26 },  // 虾
+    { 0x8715, 25 },  // 蜕
+    { 0x8863, 31 },  // 衣
+    { 0x8865, 3 },  // 补
+    { 0x8981, 30 },  // 要
+    { 0x89c2, 12 },  // 观
+    { 0x89e6, 4 },  // 触
+    { 0x8ba1, 13 },  // 计
+    { 0x8bb0, 13 },  // 记
+    { 0x8bb8, 29 },  // 许
+    { 0x8bbf, 10 },  // 访
+    { 0x8bf4, 22 },  // 说
+    { 0x8c03, 23 },  // 调
+    { 0x8c05, 17 },  // 谅
+    { 0x8c22, 28 },  // 谢
+    { 0x8d5e, 35 },  // 赞
+    { 0x8d62, 33 },  // 赢
+    { 0x8df3, 23 },  // 跳
+    { 0x8eab, 20 },  // 身
+    { 0x8eb2, 9 },  // 躲
+    { 0x8f7d, 34 },  // 载
+    { 0x8f86, 17 },  // 辆
+    { 0x8fbe, 5 },  // 达
+    { 0x8fce, 33 },  // 迎
+    { 0x8fde, 16 },  // 连
+    { 0x9000, 25 },  // 退
+    { 0x9012, 7 },  // 递
+    { 0x903c, 1 },  // 逼
+    { 0x9065, 30 },  // 遥
+    { 0x907f, 1 },  // 避
+    { 0x9080, 30 },  // 邀
+    { 0x9093, 6 },  // 邓
+    { 0x90e8, 3 },  // 部
+    { 0x917f, 18 },  // 酿
+    { 0x9189, 38 },  // 醉
+    { 0x91cd, 37 },  // 重
+    { 0x91cf, 17 },  // 量
+    { 0x949f, 37 },  // 钟
+    { 0x94f6, 32 },  // 银
+    { 0x9500, 27 },  // 销
+    { 0x955c, 14 },  // 镜
+    { 0x95ed, 1 },  // 闭
+    { 0x9632, 10 },  // 防
+    { 0x9634, 32 },  // 阴
+    { 0x9664, 4 },  // 除
+    { 0x9690, 32 },  // 隐
+    { 0x96c6, 13 },  // 集
+    { 0x9700, 29 },  // 需
+    { 0x971e, 26 },  // 霞
+    { 0x9759, 14 },  // 静
+    { 0x978b, 28 },  // 鞋
+    { 0x97f3, 32 },  // 音
+    { 0x987b, 29 },  // 须
+    { 0x9893, 25 },  // 颓
+    { 0x996e, 32 },  // 饮
+    { 0x9ad8, 11 },  // 高
+    { 0x9e70, 33 },  // 鹰
+    { 0x9f3b, 1 },  // 鼻
+};
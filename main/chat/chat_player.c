@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "audio_hardware.h"
+#include "audio_player_user.h"
+#include "chat_player.h"
+#include "http_pool.h"
+#include "prompt_bank.h"
+#include "prompt_pcm.h"
+#include "qmsd_utils.h"
+
+#define TAG "chat.player"
+
+typedef enum {
+    CHAT_PLAYER_JOB_HTTP,   // url 为 http(s) 地址
+    CHAT_PLAYER_JOB_FILES,  // url 为以 '\0' 分隔的多个本地 mp3 文件路径
+    CHAT_PLAYER_JOB_BANK,   // url 为提示音库中的提示音名称
+    CHAT_PLAYER_JOB_PCM,    // url 为预解码提示音文件路径
+} chat_player_job_type_t;
+
+typedef struct {
+    chat_player_job_type_t type;
+    uint32_t generation;
+    uint8_t file_num;
+    chat_player_tee_cb_t tee_cb;  // 不为 NULL 时 http 数据同时写入 CHAT_PLAYER_TEE_PATH
+    void* tee_ctx;
+    char url[CHAT_PLAYER_URL_SIZE];
+} chat_player_job_t;
+
+typedef struct {
+    char* data;  // NULL 表示读取结束
+    uint16_t offset;
+    uint16_t len;
+} chat_player_block_t;
+
+static QueueHandle_t player_job_queue;
+static QueueHandle_t reader_job_queue;
+static QueueHandle_t reader_free_queue;  // 空闲的预读缓冲
+static QueueHandle_t reader_data_queue;  // 已读入数据的预读缓冲
+static volatile uint32_t player_generation = 0;  // 每次新的播放或停止都会递增，旧的写入任务据此退出
+static volatile bool player_writing = false;     // 播放任务正在向 raw 流或音频硬件写入
+static chat_player_job_t* player_job;
+static char* player_buffer;
+static chat_player_job_t* reader_job;
+
+static bool chat_player_job_valid(const chat_player_job_t* job) {
+    return job->generation == player_generation;
+}
+
+// 等正在进行的写入结束，调用前已递增 player_generation，之后旧任务不会再打开或写入 raw 流
+static void chat_player_wait_writing(void) {
+    TickType_t start = xTaskGetTickCount();
+    while (player_writing && xTaskGetTickCount() - start < pdMS_TO_TICKS(CHAT_PLAYER_ABORT_TIMEOUT_MS)) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    if (player_writing) {
+        ESP_LOGW(TAG, "abort wait write timeout");
+    }
+}
+
+// 先置写入标记再检查任务是否有效，中止方看到标记清除后，旧任务不会再向 raw 流写入
+static esp_err_t chat_player_raw_write(const chat_player_job_t* job, char* data, int len) {
+    player_writing = true;
+    esp_err_t err = chat_player_job_valid(job) ? audio_player_raw_mp3_write(data, len) : ESP_ERR_INVALID_STATE;
+    player_writing = false;
+    return err;
+}
+
+// 打开 raw 流，任务已失效时不打开，避免重启接管方正在使用的管道
+static bool chat_player_raw_open(const chat_player_job_t* job) {
+    player_writing = true;
+    bool valid = chat_player_job_valid(job);
+    if (valid) {
+        audio_player_play_url(MP3_URL_FROM_RAW, 1);
+        audio_player_wait_stream_pipeline_running();
+    }
+    player_writing = false;
+    return valid;
+}
+
+// 流式播放失败时交给 audio_player 播放，与打开 raw 流一样在写入标记内检查任务是否有效
+static void chat_player_fallback_play(const chat_player_job_t* job) {
+    player_writing = true;
+    if (chat_player_job_valid(job)) {
+        ESP_LOGW(TAG, "stream open failed, fallback to player: %s", job->url);
+        audio_player_play_url(job->url, 1);
+    }
+    player_writing = false;
+}
+
+static void chat_player_raw_finish(const chat_player_job_t* job) {
+    player_writing = true;
+    if (chat_player_job_valid(job)) {
+        audio_player_raw_write_finish();
+    }
+    player_writing = false;
+}
+
+static void chat_player_http_feed(chat_player_job_t* job, char* buffer) {
+    esp_http_client_handle_t client = http_pool_acquire(job->url, 3000);
+    if (client == NULL) {
+        chat_player_fallback_play(job);
+        return;
+    }
+
+    if (http_pool_open(client, NULL) != ESP_OK) {
+        http_pool_release(client, false);
+        chat_player_fallback_play(job);
+        return;
+    }
+
+    if (chat_player_raw_open(job) == false) {
+        http_pool_release(client, false);
+        return;
+    }
+
+    // 边播边存，写文件失败只放弃保存，不影响播放
+    FILE* tee_fp = job->tee_cb ? fopen(CHAT_PLAYER_TEE_PATH, "wb") : NULL;
+    bool complete = false;
+    for (;;) {
+        int len = esp_http_client_read(client, buffer, CHAT_PLAYER_BUFFER_SIZE);
+        if (len < 0) {
+            ESP_LOGE(TAG, "stream read failed: %d", len);
+            break;
+        }
+        if (len == 0) {
+            complete = esp_http_client_is_complete_data_received(client);
+            break;
+        }
+        if (chat_player_raw_write(job, buffer, len) != ESP_OK) {
+            break;
+        }
+        if (tee_fp && fwrite(buffer, 1, len, tee_fp) != (size_t)len) {
+            ESP_LOGW(TAG, "tee write failed, stop saving");
+            fclose(tee_fp);
+            tee_fp = NULL;
+            remove(CHAT_PLAYER_TEE_PATH);
+        }
+    }
+
+    bool valid = chat_player_job_valid(job);
+    chat_player_raw_finish(job);
+    http_pool_release(client, complete);
+
+    if (tee_fp) {
+        fclose(tee_fp);
+        if (complete && valid) {
+            job->tee_cb(CHAT_PLAYER_TEE_PATH, job->tee_ctx);
+        }
+        remove(CHAT_PLAYER_TEE_PATH);
+    }
+}
+
+// 读取 ID3v2 标签长度，没有标签时返回 0
+static uint32_t chat_player_mp3_tag_size(FILE* fp) {
+    uint8_t data[10];
+    uint32_t tag_size = 0;
+    if (fread(data, 1, sizeof(data), fp) == sizeof(data) && memcmp(data, "ID3", 3) == 0) {
+        tag_size = ((data[6] & 0x7f) << 21) | ((data[7] & 0x7f) << 14) | ((data[8] & 0x7f) << 7) | (data[9] & 0x7f);
+        tag_size += (data[5] & 0x10) ? 20 : 10;
+    }
+    fseek(fp, tag_size, SEEK_SET);
+    return tag_size;
+}
+
+// 返回第一个 mp3 帧同步字之前的字节数
+static uint16_t chat_player_mp3_sync_offset(const uint8_t* data, int len) {
+    for (int i = 0; i + 1 < len; i++) {
+        if (data[i] == 0xff && (data[i + 1] & 0xe0) == 0xe0) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+// 按 CHAT_PLAYER_READ_AHEAD_SIZE 对齐整块读取一个文件，读满一块交给播放任务
+static void chat_player_reader_file(chat_player_job_t* job, const char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "open %s failed", path);
+        return;
+    }
+    // 整块读取直接落到 littlefs，不经过 stdio 的小缓冲
+    setvbuf(fp, NULL, _IONBF, 0);
+    uint32_t pos = chat_player_mp3_tag_size(fp);
+    bool first = true;
+    while (chat_player_job_valid(job)) {
+        chat_player_block_t block = { 0 };
+        xQueueReceive(reader_free_queue, &block.data, portMAX_DELAY);
+        // 跳过标签后的第一次读取只读到块边界，之后每次都是对齐的整块
+        int len = fread(block.data, 1, CHAT_PLAYER_READ_AHEAD_SIZE - pos % CHAT_PLAYER_READ_AHEAD_SIZE, fp);
+        if (len <= 0) {
+            xQueueSend(reader_free_queue, &block.data, portMAX_DELAY);
+            break;
+        }
+        pos += len;
+        block.offset = first ? chat_player_mp3_sync_offset((uint8_t*)block.data, len) : 0;
+        block.len = len;
+        first = false;
+        xQueueSend(reader_data_queue, &block, portMAX_DELAY);
+    }
+    fclose(fp);
+}
+
+// 预读任务，优先级低于播放任务，只在播放任务消费缓冲时补读，flash 的 GC 或同步写入造成的停顿由另一块缓冲吸收
+static void chat_player_reader_task(void* arg) {
+    chat_player_job_t* job = reader_job;
+    for (;;) {
+        if (xQueueReceive(reader_job_queue, job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        const char* path = job->url;
+        for (int i = 0; i < job->file_num && chat_player_job_valid(job); i++, path += strlen(path) + 1) {
+            chat_player_reader_file(job, path);
+        }
+        // data 为 NULL 表示本次任务读取结束
+        chat_player_block_t end = { 0 };
+        xQueueSend(reader_data_queue, &end, portMAX_DELAY);
+    }
+}
+
+// 多个 mp3 文件去掉标签后按帧边界首尾相接，作为一个 raw 流播放，文件内容由预读任务提供
+static void chat_player_files_feed(chat_player_job_t* job) {
+    if (chat_player_raw_open(job) == false) {
+        return;
+    }
+
+    xQueueSend(reader_job_queue, job, portMAX_DELAY);
+    bool write_ok = true;
+    for (;;) {
+        chat_player_block_t block;
+        xQueueReceive(reader_data_queue, &block, portMAX_DELAY);
+        if (block.data == NULL) {
+            break;
+        }
+        // 中止后继续取完剩余的块，把缓冲还给预读任务
+        if (write_ok) {
+            write_ok = chat_player_raw_write(job, block.data + block.offset, block.len - block.offset) == ESP_OK;
+        }
+        xQueueSend(reader_free_queue, &block.data, portMAX_DELAY);
+    }
+    chat_player_raw_finish(job);
+}
+
+// 直接把映射的 flash 数据写入 raw 流，没有文件系统读取
+static void chat_player_bank_feed(chat_player_job_t* job) {
+    const uint8_t* data = NULL;
+    uint32_t size = 0;
+    if (prompt_bank_acquire(job->url, &data, &size) == false) {
+        ESP_LOGE(TAG, "prompt %s not in bank", job->url);
+        return;
+    }
+
+    if (chat_player_raw_open(job) == false) {
+        prompt_bank_release();
+        return;
+    }
+    for (uint32_t offset = 0; offset < size; offset += CHAT_PLAYER_BUFFER_SIZE) {
+        uint32_t len = size - offset > CHAT_PLAYER_BUFFER_SIZE ? CHAT_PLAYER_BUFFER_SIZE : size - offset;
+        if (chat_player_raw_write(job, (char*)data + offset, len) != ESP_OK) {
+            break;
+        }
+    }
+    prompt_bank_release();
+    chat_player_raw_finish(job);
+}
+
+// 与 raw 流写入一样在写入标记内检查任务是否有效，中止返回后不会再有 PCM 写入音频硬件
+static bool chat_player_pcm_write(char* data, uint32_t len, void* ctx) {
+    player_writing = true;
+    bool valid = chat_player_job_valid((chat_player_job_t*)ctx);
+    if (valid) {
+        audio_hardware_data_write(data, len);
+    }
+    player_writing = false;
+    return valid;
+}
+
+// 预解码提示音不经过 mp3 管道，先停掉管道再直接写入音频硬件
+static void chat_player_pcm_feed(chat_player_job_t* job) {
+    player_writing = true;
+    bool valid = chat_player_job_valid(job);
+    if (valid) {
+        audio_player_stop_speak();
+        audio_hardware_write_reset();
+    }
+    player_writing = false;
+    if (valid && prompt_pcm_play(job->url, chat_player_pcm_write, job) != ESP_OK) {
+        ESP_LOGE(TAG, "play pcm %s failed", job->url);
+    }
+}
+
+static void chat_player_task(void* arg) {
+    chat_player_job_t* job = player_job;
+    char* buffer = player_buffer;
+    for (;;) {
+        if (xQueueReceive(player_job_queue, job, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (chat_player_job_valid(job) == false) {
+            continue;
+        }
+        if (job->type == CHAT_PLAYER_JOB_FILES) {
+            chat_player_files_feed(job);
+        } else if (job->type == CHAT_PLAYER_JOB_BANK) {
+            chat_player_bank_feed(job);
+        } else if (job->type == CHAT_PLAYER_JOB_PCM) {
+            chat_player_pcm_feed(job);
+        } else {
+            chat_player_http_feed(job, buffer);
+        }
+    }
+}
+
+void chat_player_init(void) {
+    if (player_job_queue) {
+        return;
+    }
+    http_pool_init();
+
+    // 缓冲在初始化时一次分配，失败时不启用，播放直接交给 audio_player
+    char* read_ahead[CHAT_PLAYER_READ_AHEAD_NUM] = { 0 };
+    player_job = qmsd_malloc(sizeof(chat_player_job_t));
+    player_buffer = qmsd_malloc(CHAT_PLAYER_BUFFER_SIZE);
+    reader_job = qmsd_malloc(sizeof(chat_player_job_t));
+    bool ok = player_job && player_buffer && reader_job;
+    for (int i = 0; i < CHAT_PLAYER_READ_AHEAD_NUM; i++) {
+        read_ahead[i] = qmsd_malloc(CHAT_PLAYER_READ_AHEAD_SIZE);
+        ok = ok && read_ahead[i];
+    }
+    if (ok == false) {
+        ESP_LOGE(TAG, "no memory, stream player disabled");
+        for (int i = 0; i < CHAT_PLAYER_READ_AHEAD_NUM; i++) {
+            qmsd_free(read_ahead[i]);
+        }
+        qmsd_free(player_job);
+        qmsd_free(player_buffer);
+        qmsd_free(reader_job);
+        player_job = NULL;
+        player_buffer = NULL;
+        reader_job = NULL;
+        return;
+    }
+
+    reader_job_queue = xQueueCreate(1, sizeof(chat_player_job_t));
+    reader_free_queue = xQueueCreate(CHAT_PLAYER_READ_AHEAD_NUM, sizeof(char*));
+    reader_data_queue = xQueueCreate(CHAT_PLAYER_READ_AHEAD_NUM + 1, sizeof(chat_player_block_t));
+    for (int i = 0; i < CHAT_PLAYER_READ_AHEAD_NUM; i++) {
+        xQueueSend(reader_free_queue, &read_ahead[i], 0);
+    }
+    player_job_queue = xQueueCreate(2, sizeof(chat_player_job_t));
+    qmsd_thread_create(chat_player_task, "chat_player_task", 4 * 1024, NULL, AUDIO_PLAYER_TASK_PRIO - 1, NULL, 0, 1);
+    qmsd_thread_create(chat_player_reader_task, "chat_player_reader", 3 * 1024, NULL, 3, NULL, 0, 1);
+}
+
+static bool chat_player_job_send(chat_player_job_t* job) {
+    job->generation = player_generation;
+    if (xQueueSend(player_job_queue, job, 0) != pdTRUE) {
+        // 队列中旧的任务已失效，直接丢弃
+        xQueueReset(player_job_queue);
+        return xQueueSend(player_job_queue, job, 0) == pdTRUE;
+    }
+    return true;
+}
+
+void chat_player_play_url(const char* url) {
+    chat_player_play_url_tee(url, NULL, NULL);
+}
+
+void chat_player_play_url_tee(const char* url, chat_player_tee_cb_t tee_cb, void* ctx) {
+    if (url == NULL) {
+        return;
+    }
+    player_generation += 1;
+    bool is_bank = strncmp(url, BANK_URL_PREFIX, strlen(BANK_URL_PREFIX)) == 0;
+    bool is_file = strncmp(url, MP3_URL_FROM_FILE, strlen(MP3_URL_FROM_FILE)) == 0;
+    chat_player_job_t* job = NULL;
+    if (player_job_queue == NULL || (strncmp(url, "http", 4) != 0 && is_bank == false && is_file == false) ||
+        strlen(url) >= CHAT_PLAYER_URL_SIZE || (job = qmsd_malloc(sizeof(chat_player_job_t))) == NULL) {
+        // 直接交给 audio_player，先等旧任务的写入结束，避免它在之后重新打开或写入 raw 流
+        chat_player_wait_writing();
+        audio_player_play_url(url, 1);
+        return;
+    }
+    job->tee_cb = (is_bank || is_file) ? NULL : tee_cb;
+    job->tee_ctx = ctx;
+    if (is_bank) {
+        job->type = CHAT_PLAYER_JOB_BANK;
+        strcpy(job->url, url + strlen(BANK_URL_PREFIX));
+    } else if (is_file) {
+        // 文件地址按 MP3_URL_FROM_FILE "/littlefs/..." 拼接，去掉整个前缀后得到文件系统路径
+        job->type = CHAT_PLAYER_JOB_FILES;
+        job->file_num = 1;
+        strcpy(job->url, url + strlen(MP3_URL_FROM_FILE));
+    } else {
+        job->type = CHAT_PLAYER_JOB_HTTP;
+        strcpy(job->url, url);
+    }
+    chat_player_job_send(job);
+    qmsd_free(job);
+}
+
+bool chat_player_play_pcm(const char* path) {
+    if (player_job_queue == NULL || path == NULL || strlen(path) >= CHAT_PLAYER_URL_SIZE) {
+        return false;
+    }
+    chat_player_job_t* job = qmsd_malloc(sizeof(chat_player_job_t));
+    if (job == NULL) {
+        return false;
+    }
+    job->type = CHAT_PLAYER_JOB_PCM;
+    job->tee_cb = NULL;
+    strcpy(job->url, path);
+
+    player_generation += 1;
+    bool ret = chat_player_job_send(job);
+    qmsd_free(job);
+    return ret;
+}
+
+bool chat_player_play_files(const char* const* paths, uint8_t num) {
+    if (player_job_queue == NULL || paths == NULL || num == 0) {
+        return false;
+    }
+    chat_player_job_t* job = qmsd_malloc(sizeof(chat_player_job_t));
+    if (job == NULL) {
+        return false;
+    }
+
+    uint32_t offset = 0;
+    for (int i = 0; i < num; i++) {
+        uint32_t len = strlen(paths[i]) + 1;
+        if (offset + len > CHAT_PLAYER_URL_SIZE) {
+            qmsd_free(job);
+            return false;
+        }
+        memcpy(job->url + offset, paths[i], len);
+        offset += len;
+    }
+    job->type = CHAT_PLAYER_JOB_FILES;
+    job->tee_cb = NULL;
+    job->file_num = num;
+
+    player_generation += 1;
+    bool ret = chat_player_job_send(job);
+    qmsd_free(job);
+    return ret;
+}
+
+void chat_player_abort_stream(void) {
+    player_generation += 1;
+    // 接管方打开的 raw 流里不会混入旧数据
+    chat_player_wait_writing();
+}
+
+void chat_player_stop(void) {
+    player_generation += 1;
+    // 正在打开 raw 流的旧任务会在停止之后重新启动管道，且因任务失效不再结束，先等它退出
+    chat_player_wait_writing();
+    audio_player_stop_speak();
+}
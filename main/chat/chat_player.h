@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief 流式播放任务的读缓冲大小 */
+#define CHAT_PLAYER_BUFFER_SIZE 2048
+/** @brief 本地文件预读缓冲大小，与 flash 扇区对齐，每次读取一整块 */
+#define CHAT_PLAYER_READ_AHEAD_SIZE 4096
+/** @brief 本地文件预读缓冲数量 */
+#define CHAT_PLAYER_READ_AHEAD_NUM 2
+/** @brief 播放地址最大长度 */
+#define CHAT_PLAYER_URL_SIZE 512
+/** @brief 提示音库地址前缀，bank:/<id> 直接播放映射到内存的提示音库分区中的音频 */
+#define BANK_URL_PREFIX "bank:/"
+/** @brief 边播边存的临时文件 */
+#define CHAT_PLAYER_TEE_PATH "/littlefs/tee.tmp"
+/** @brief 中止时等待正在进行的 raw 写入结束的最长时间(ms) */
+#define CHAT_PLAYER_ABORT_TIMEOUT_MS 1000
+
+/**
+ * @brief 边播边存完成回调
+ * @param path 完整音频文件路径，回调返回后该文件会被删除，需要保留时在回调中 rename
+ * @param ctx chat_player_play_url_tee 传入的参数
+ * @note 只在数据完整接收且播放未被打断时调用，运行在播放任务中
+ */
+typedef void (*chat_player_tee_cb_t)(const char* path, void* ctx);
+
+/**
+ * @brief 初始化应用层播放器
+ * @note 创建流式写入任务，需要在 audio_player_init 之后调用
+ */
+void chat_player_init(void);
+
+/**
+ * @brief 播放指定地址的音频
+ * @param url 音频地址
+ * @note http(s) 地址由后台任务通过连接池(http_pool)拉取，写入播放器的 raw 流，
+ *       连接在多次播放之间保持，避免每次回复都重新握手；bank:/<id> 从提示音库分区的映射地址直接写入 raw 流；
+ *       file:/<path> 由低优先级的预读任务整块读入双缓冲后写入 raw 流；其他地址直接交给 audio_player_play_url
+ */
+void chat_player_play_url(const char* url);
+
+/**
+ * @brief 播放 http(s) 音频，同时把收到的数据写入 CHAT_PLAYER_TEE_PATH
+ * @param url 音频地址
+ * @param tee_cb 数据完整接收后的回调，为 NULL 时与 chat_player_play_url 相同
+ * @param ctx 回调参数
+ * @note 用于把在线播放的 TTS 直接存入缓存，同一段音频不需要再下载一次
+ */
+void chat_player_play_url_tee(const char* url, chat_player_tee_cb_t tee_cb, void* ctx);
+
+/**
+ * @brief 播放预解码(PCM/ADPCM)提示音文件
+ * @param path 文件路径(不带 file:/ 前缀)，格式见 prompt_pcm.h
+ * @return true 已加入播放队列，false 失败
+ * @note 停止 mp3 管道后直接写入音频硬件，没有解码器启动延迟
+ */
+bool chat_player_play_pcm(const char* path);
+
+/**
+ * @brief 依次播放多个本地 mp3 文件
+ * @param paths 文件路径列表(不带 file:/ 前缀)
+ * @param num 文件数量
+ * @return true 已加入播放队列，false 路径总长度超过 CHAT_PLAYER_URL_SIZE 或未初始化
+ * @note 各文件去掉 ID3 标签后按帧边界写入同一个 raw 流，中间没有重新建管道的停顿，
+ *       用于拼接本地短语片段
+ */
+bool chat_player_play_files(const char* const* paths, uint8_t num);
+
+/**
+ * @brief 中止后台流式写入，不停止播放器
+ * @note 其他模块接管 raw 流(如 websocket 下发音频)之前调用。返回前等待正在进行的写入结束
+ *       (最长 CHAT_PLAYER_ABORT_TIMEOUT_MS)，之后旧任务不会再打开或写入 raw 流
+ */
+void chat_player_abort_stream(void);
+
+/**
+ * @brief 停止当前播放，包括后台流式写入
+ * @note 与 chat_player_abort_stream 一样先等待正在进行的写入结束，再停止播放器
+ */
+void chat_player_stop(void);
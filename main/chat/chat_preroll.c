@@ -0,0 +1,65 @@
+#include <string.h>
+
+#include "chat_preroll.h"
+#include "esp_log.h"
+#include "gx8006.h"
+
+#define TAG "chat.preroll"
+
+#define CHAT_PREROLL_SLOTS (CHAT_PREROLL_MS / GX8006_VAD_FRAME_MS)
+
+typedef struct {
+    uint16_t len;
+    uint32_t keep_ms;
+    uint8_t data[CHAT_PREROLL_PACKET_MAX];
+} chat_preroll_slot_t;
+
+static chat_preroll_slot_t preroll_slots[CHAT_PREROLL_SLOTS];
+static uint8_t preroll_head = 0;  // 最旧的一包
+static uint8_t preroll_count = 0;
+
+void chat_preroll_reset(void) {
+    preroll_head = 0;
+    preroll_count = 0;
+}
+
+void chat_preroll_push(const uint8_t* data, uint32_t len, uint32_t keep_ms) {
+    if (data == NULL || len == 0) {
+        return;
+    }
+    if (len > CHAT_PREROLL_PACKET_MAX) {
+        ESP_LOGD(TAG, "packet too large %lu, skip", len);
+        return;
+    }
+
+    uint8_t index = (preroll_head + preroll_count) % CHAT_PREROLL_SLOTS;
+    if (preroll_count == CHAT_PREROLL_SLOTS) {
+        // 缓冲满，覆盖最旧的一包
+        preroll_head = (preroll_head + 1) % CHAT_PREROLL_SLOTS;
+    } else {
+        preroll_count += 1;
+    }
+
+    preroll_slots[index].len = len;
+    preroll_slots[index].keep_ms = keep_ms;
+    memcpy(preroll_slots[index].data, data, len);
+}
+
+uint32_t chat_preroll_flush(chat_preroll_flush_cb_t cb, uint32_t min_keep_ms) {
+    uint32_t flush_num = 0;
+    for (uint8_t i = 0; i < preroll_count; i++) {
+        chat_preroll_slot_t* slot = &preroll_slots[(preroll_head + i) % CHAT_PREROLL_SLOTS];
+        if (slot->keep_ms < min_keep_ms) {
+            continue;
+        }
+        if (cb) {
+            cb(slot->data, slot->len);
+        }
+        flush_num += 1;
+    }
+    chat_preroll_reset();
+    if (flush_num) {
+        ESP_LOGI(TAG, "flush preroll packets: %lu", flush_num);
+    }
+    return flush_num;
+}
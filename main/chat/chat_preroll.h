@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief 预录缓冲时长(ms)，唤醒后用户立即说话时，这段音频会在上传开始时补发，按 GX8006_VAD_FRAME_MS 一包计算包数 */
+#define CHAT_PREROLL_MS 480
+/** @brief 单包音频最大字节数，超过的包不缓存 */
+#define CHAT_PREROLL_PACKET_MAX 320
+/** @brief 唤醒后这段时间内收到的音频视为唤醒词，补发时丢弃 */
+#define CHAT_PREROLL_SKIP_MS 300
+
+/**
+ * @brief 预录包补发回调函数类型
+ * @param data 音频数据
+ * @param len 音频数据长度
+ */
+typedef void (*chat_preroll_flush_cb_t)(uint8_t* data, uint32_t len);
+
+/**
+ * @brief 清空预录缓冲
+ * @note 唤醒、休眠、一轮上传结束时调用
+ */
+void chat_preroll_reset(void);
+
+/**
+ * @brief 缓存一包上传前的音频
+ * @param data 音频数据
+ * @param len 音频数据长度
+ * @param keep_ms 收到该包时的唤醒保持时间，用于补发时过滤唤醒词
+ * @note 缓冲满时覆盖最旧的一包，只在GX8006音频回调中调用，不加锁
+ */
+void chat_preroll_push(const uint8_t* data, uint32_t len, uint32_t keep_ms);
+
+/**
+ * @brief 按接收顺序补发缓存的音频，并清空缓冲
+ * @param cb 补发回调，一般为 aiha_websocket_audio_upload_data
+ * @param min_keep_ms 只补发唤醒保持时间不小于该值的包
+ * @return 补发的包数量
+ */
+uint32_t chat_preroll_flush(chat_preroll_flush_cb_t cb, uint32_t min_keep_ms);
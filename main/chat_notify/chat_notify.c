@@ -1,20 +1,22 @@
+#include <dirent.h>
 #include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
 #include "esp_log.h"
 
 #include "aiha_audio_http.h"
 #include "aiha_websocket.h"
 #include "audio_player_user.h"
 #include "chat_notify.h"
-#include "fs_utils.h"
+#include "chat_notify_manifest.h"
+#include "chat_notify_sync.h"
+#include "chat_phrase.h"
+#include "chat_player.h"
+#include "prompt_bank.h"
+#include "prompt_pcm.h"
 #include "qmsd_utils.h"
-
-#define AUDIO_PATH "/littlefs"
-#define TEMP_FILE_PATH "/littlefs/temp.mp3"
-
-#define NOTIFY_PATH_COVER(notify_path, hashcode, file_path)                    \
-    do {                                                                       \
-        sprintf(file_path, "%s/%s@%d.mp3", AUDIO_PATH, notify_path, hashcode); \
-    } while (0)
+#include "res_pack.h"
+#include "tts_cache.h"
 
 // 声明 aiha_tts_cb 函数
 extern void aiha_tts_cb(const char* url, void* user_data);
@@ -22,6 +24,19 @@ extern chat_notify_t chat_notify_list[];
 
 #define TAG "chat_notify"
 
+// 放入提示音库分区的通知，对延迟最敏感
+static const chat_notify_status_t bank_notify_list[] = {
+    NOTIFY_CHAT_WAKEUP,
+    NOTIFY_CHAT_WAKEUP_VC,
+    NOTIFY_CHAT_WAKEUP_VC2,
+};
+
+// 预解码提示音对应的音色，pcm_ready 只对该音色有效
+static int pcm_hashcode = 0;
+static bool pcm_ready[MAX_NOTIFY_TYPE];
+
+#define PCM_PATH_COVER(path, hashcode, out_path) sprintf(out_path, "%s/%s@%d.pcm", NOTIFY_AUDIO_PATH, path, hashcode)
+
 void chat_notify_audio_play(chat_notify_status_t notify_status, void* data) {
     chat_notify_t notify_item = chat_notify_list[notify_status];
 
@@ -31,30 +46,46 @@ void chat_notify_audio_play(chat_notify_status_t notify_status, void* data) {
         return;
     }
 
+    // 已预解码的提示音直接写入音频硬件，省掉 mp3 解码器启动和解码
+    int hashcode = aiha_websocket_get_tts_hashcode();
+    if (pcm_ready[notify_status] && pcm_hashcode == hashcode) {
+        PCM_PATH_COVER(notify_item.path, hashcode, path);
+        chat_player_play_pcm(path);
+        return;
+    }
+
+    // 提示音库中有当前音色的版本，直接从映射的 flash 播放；音色未知时也使用库中的版本
+    prompt_bank_entry_t bank_entry;
+    if (prompt_bank_find(notify_item.path, &bank_entry) && (bank_entry.hashcode == 0 || hashcode == 0 || bank_entry.hashcode == hashcode)) {
+        sprintf(path, BANK_URL_PREFIX "%s", notify_item.path);
+        chat_player_play_url(path);
+        return;
+    }
+
     // 文件存在
     if (notify_item.file_exist == 1) {
         char path_temp[256] = { 0 };
         NOTIFY_PATH_COVER(notify_item.path, aiha_websocket_get_tts_hashcode(), path_temp);
         sprintf(path, MP3_URL_FROM_FILE"%s", path_temp);
-        audio_player_play_url(path, 1);
+        chat_player_play_url(path);
         return;
     }
     if (notify_item.tts_sync_type == TTS_SYNC_DISABLE) {
         sprintf(path, MP3_URL_FROM_FILE"/littlefs/%s.mp3", notify_item.path);
-        audio_player_play_url(path, 1);
+        chat_player_play_url(path);
         return;
     }
 
     // 网络优先
     if (notify_item.tts_sync_type == TTS_SYNC_FROM_NET) {
-        aiha_request_tts_async(notify_item.tts_text);
+        tts_cache_play(notify_item.tts_text);
         return;
     }
 
     if (notify_item.tts_sync_type == TTS_SYNC_FROM_FILE) {
         if (notify_item.path_temp) {
             sprintf(path, MP3_URL_FROM_FILE"%s", notify_item.path_temp);
-            audio_player_play_url(path, 1);
+            chat_player_play_url(path);
             ESP_LOGI(TAG, "play tts file: %s", path);
         } else {
             ESP_LOGE(TAG, "%s tts_sync_type is TTS_SYNC_FROM_FILE, but path_temp is NULL", notify_item.path);
@@ -63,29 +94,128 @@ void chat_notify_audio_play(chat_notify_status_t notify_status, void* data) {
     }
 }
 
+// 提示音库中的音色与当前音色不一致时，用已同步的文件重新打包，每个音色只尝试一次
+static void chat_notify_bank_refresh(int hashcode) {
+    static int bank_hashcode = 0;
+    const uint8_t num = sizeof(bank_notify_list) / sizeof(bank_notify_list[0]);
+    prompt_bank_src_t src[sizeof(bank_notify_list) / sizeof(bank_notify_list[0])];
+    char file_path[sizeof(bank_notify_list) / sizeof(bank_notify_list[0])][64];
+    bool stale = false;
+
+    if (bank_hashcode == hashcode) {
+        return;
+    }
+    for (int i = 0; i < num; i++) {
+        chat_notify_status_t id = bank_notify_list[i];
+        chat_notify_asset_t asset;
+        if (chat_notify_manifest_get(id, &asset) == false || asset.hashcode != hashcode) {
+            return;
+        }
+        prompt_bank_entry_t bank_entry;
+        stale = stale || prompt_bank_find(chat_notify_list[id].path, &bank_entry) == false || bank_entry.hashcode != hashcode;
+        snprintf(file_path[i], sizeof(file_path[i]), "%s/%s", NOTIFY_AUDIO_PATH, asset.name);
+        src[i].id = chat_notify_list[id].path;
+        src[i].hashcode = hashcode;
+        src[i].file_path = file_path[i];
+    }
+    bank_hashcode = hashcode;
+    if (stale) {
+        prompt_bank_pack(src, num);
+    }
+}
+
+// 删除不属于当前音色的预解码文件及转码中断留下的临时文件
+// pcm_hashcode 每次开机从 0 开始，不能只按上一个音色删除，否则重启前的旧音色文件会一直留在分区中
+static void chat_notify_pcm_clean(int hashcode) {
+    DIR* dir = opendir(NOTIFY_AUDIO_PATH);
+    if (dir == NULL) {
+        ESP_LOGE(TAG, "Failed to open directory: %s", NOTIFY_AUDIO_PATH);
+        return;
+    }
+
+    char suffix[24];
+    char file_path[64];
+    snprintf(suffix, sizeof(suffix), "@%d.pcm", hashcode);
+    uint32_t suffix_len = strlen(suffix);
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint32_t name_len = strlen(entry->d_name);
+        if (entry->d_type != DT_REG || strstr(entry->d_name, ".pcm") == NULL) {
+            continue;
+        }
+        if (name_len > suffix_len && strcmp(entry->d_name + name_len - suffix_len, suffix) == 0) {
+            continue;
+        }
+        snprintf(file_path, sizeof(file_path), "%s/%s", NOTIFY_AUDIO_PATH, entry->d_name);
+        if (remove(file_path) == 0) {
+            ESP_LOGI(TAG, "remove stale pcm: %s", entry->d_name);
+        }
+    }
+    closedir(dir);
+}
+
+// 把唤醒提示音转码为预解码格式，每个音色只转码一次，音色变化后删除旧音色的文件
+static void chat_notify_pcm_refresh(int hashcode) {
+    const uint8_t num = sizeof(bank_notify_list) / sizeof(bank_notify_list[0]);
+    char mp3_path[64];
+    char pcm_path[64];
+
+    if (pcm_hashcode == hashcode) {
+        return;
+    }
+    for (int i = 0; i < num; i++) {
+        chat_notify_asset_t asset;
+        if (chat_notify_manifest_get(bank_notify_list[i], &asset) == false || asset.hashcode != hashcode) {
+            return;
+        }
+    }
+
+    for (int i = 0; i < num; i++) {
+        pcm_ready[bank_notify_list[i]] = false;
+    }
+    chat_notify_pcm_clean(hashcode);
+    pcm_hashcode = hashcode;
+    for (int i = 0; i < num; i++) {
+        chat_notify_status_t id = bank_notify_list[i];
+        chat_notify_asset_t asset;
+        if (chat_notify_manifest_get(id, &asset) == false) {
+            pcm_ready[id] = false;
+            continue;
+        }
+        snprintf(mp3_path, sizeof(mp3_path), "%s/%s", NOTIFY_AUDIO_PATH, asset.name);
+        PCM_PATH_COVER(chat_notify_list[id].path, hashcode, pcm_path);
+        struct stat file_stat;
+        pcm_ready[id] = stat(pcm_path, &file_stat) == 0 || prompt_pcm_transcode(mp3_path, pcm_path) == ESP_OK;
+    }
+}
+
 // 文件同步任务, 用于将tts文件同步到littlefs
 // 1. 如果tts_sync_type为TTS_SYNC_FROM_FILE, 需要先读取老文件地址
 // 2. 如果判断为TTS_NET, 在没文件的时候，从网络进行tts下载
 // 3. 如果判断为TTS_DISABLE, 则不进行同步
+// 下载由 chat_notify_sync 调度: 本任务按优先级请求 TTS 地址，下载任务并行拉取并支持续传
 static void chat_file_sync_task(void* arg) {
     chat_notify_t* notify_list = chat_notify_list;
-    char file_path[256] = { 0 };
     int hashcode = 0;
+    bool res_pack_checked = false;
     ESP_LOGI(TAG, "chat file sync task start, wait tts hashcode");
     for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
         if (notify_list[i].enable == 0) {
             continue;
         }
         if (notify_list[i].tts_sync_type == TTS_SYNC_FROM_FILE) {
-            char full_path[256] = { 0 };
-            if (fs_find_file(AUDIO_PATH, notify_list[i].path, full_path, sizeof(full_path))) {
-                notify_list[i].path_temp = qmsd_malloc(strlen(full_path) + 1);
-                strcpy(notify_list[i].path_temp, full_path);
+            chat_notify_asset_t asset;
+            if (chat_notify_manifest_get(i, &asset)) {
+                notify_list[i].path_temp = qmsd_malloc(sizeof(NOTIFY_AUDIO_PATH) + strlen(asset.name) + 1);
+                sprintf(notify_list[i].path_temp, "%s/%s", NOTIFY_AUDIO_PATH, asset.name);
             }
             continue;
         }
     }
 
+    // 等待联网期间校验已有文件，损坏的文件从清单中删除后按缺失重新下载
+    chat_notify_manifest_verify();
+
     for (;;) {
         if (aiha_websocket_is_connected()) {
             break;
@@ -94,60 +224,45 @@ static void chat_file_sync_task(void* arg) {
     }
 
     for (;;) {
-        hashcode = aiha_websocket_get_tts_hashcode();
-        if (hashcode != 0) {
-            break;
+        // 音色变化后重新生成待同步列表
+        int tts_hashcode = aiha_websocket_get_tts_hashcode();
+        if (tts_hashcode != 0 && tts_hashcode != hashcode) {
+            hashcode = tts_hashcode;
+            ESP_LOGI(TAG, "tts hashcode: %d", hashcode);
+            chat_notify_sync_reset(hashcode);
         }
-        vTaskDelay(pdMS_TO_TICKS(100));
-    }
-
-    ESP_LOGI(TAG, "tts hashcode: %d", hashcode);
-    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
-        if (notify_list[i].enable == 0) {
+        if (hashcode == 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));
             continue;
         }
-        if (notify_list[i].tts_sync_type == TTS_SYNC_DISABLE) {
-            notify_list[i].file_exist = 1;
+
+        uint32_t wait_ms = 0;
+        if (chat_notify_sync_resolve(&wait_ms)) {
+            vTaskDelay(pdMS_TO_TICKS(wait_ms));
             continue;
         }
-        NOTIFY_PATH_COVER(notify_list[i].path, hashcode, file_path);
-        notify_list[i].file_exist = fs_file_exists(file_path);
-        if (notify_list[i].file_exist == 1) {
-            fs_delete_matching_files(AUDIO_PATH, notify_list[i].path, file_path);
-        }
-    }
 
-    for (;;) {
-        vTaskDelay(pdMS_TO_TICKS(100));
+        chat_notify_bank_refresh(hashcode);
+        chat_notify_pcm_refresh(hashcode);
 
-        // check network
-        for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
-            if (notify_list[i].enable == 0) {
-                continue;
-            }
+        // 提示音同步完成后每次开机检查一次资源包，失败时已下载的文件保留到下次继续
+        if (res_pack_checked == false) {
+            res_pack_checked = true;
+            res_pack_update();
+        }
 
-            if (notify_list[i].file_exist == 0) {
-                NOTIFY_PATH_COVER(notify_list[i].path, hashcode, file_path);
-
-                if (aiha_tts_download_audio_to_file(notify_list[i].tts_text, TEMP_FILE_PATH) != ESP_OK) {
-                    vTaskDelay(pdMS_TO_TICKS(5000));
-                    continue;
-                }
-                rename(TEMP_FILE_PATH, file_path);
-                notify_list[i].file_exist = 1;
-                if (notify_list[i].path_temp) {
-                    free(notify_list[i].path_temp);
-                    notify_list[i].path_temp = NULL;
-                }
-                ESP_LOGI(TAG, "success update tts file: %s", file_path);
-
-                // 删除旧文件
-                fs_delete_matching_files(AUDIO_PATH, notify_list[i].path, file_path);
-            }
+        // 提示音之后同步本地短语片段
+        if (chat_phrase_sync(hashcode) != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(5000));
         }
+        vTaskDelay(pdMS_TO_TICKS(100));
     }
 }
 
 void chat_notify_init(void) {
+    chat_notify_manifest_init();
+    // 在播放和打包任何资源之前完成上次中断的资源包替换
+    res_pack_init();
+    prompt_bank_init();
     qmsd_thread_create(chat_file_sync_task, "chat_file_sync_task", 5120, NULL, 5, NULL, 0, 1);
 }
@@ -3,6 +3,15 @@
 #include "esp_err.h"
 #include "stdint.h"
 
+/** @brief 提示音文件目录 */
+#define NOTIFY_AUDIO_PATH "/littlefs"
+
+/** @brief 生成通知在指定音色下的文件路径 */
+#define NOTIFY_PATH_COVER(notify_path, hashcode, file_path)                           \
+    do {                                                                              \
+        sprintf(file_path, "%s/%s@%d.mp3", NOTIFY_AUDIO_PATH, notify_path, hashcode); \
+    } while (0)
+
 /**
  * @brief 聊天通知状态枚举
  * @note 定义了系统中各种需要播放提示音的状态类型
@@ -63,6 +72,7 @@ typedef struct {
     uint8_t enable;                    // 是否启用该通知
     tts_sync_type_t tts_sync_type;     // TTS同步类型
     uint8_t file_exist;                // 文件是否存在标志
+    uint8_t sync_priority;             // 同步优先级，数值越大越先下载
 } chat_notify_t;
 
 /**
@@ -51,19 +51,19 @@ chat_notify_t chat_notify_list[MAX_NOTIFY_TYPE] = {
     },
     [NOTIFY_CHAT_WAKEUP] = { 
         .notify_id = NOTIFY_CHAT_WAKEUP, .path = "wakeup", .enable = 1, 
-        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "你好呀",
+        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "你好呀", .sync_priority = 2,
     },
     [NOTIFY_CHAT_WAKEUP_VC] = { 
         .notify_id = NOTIFY_CHAT_WAKEUP_VC, .path = "wakeup1", .enable = 1, 
-        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "在呢",
+        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "在呢", .sync_priority = 2,
     },
     [NOTIFY_CHAT_WAKEUP_VC2] = { 
         .notify_id = NOTIFY_CHAT_WAKEUP_VC2, .path = "wakeup2", .enable = 1, 
-        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "怎么呢",
+        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "怎么呢", .sync_priority = 2,
     },
     [NOTIFY_CONNECT_SUCCESS] = { 
         .notify_id = NOTIFY_CONNECT_SUCCESS, .path = "connect_success", .enable = 1, 
-        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "网络连接成功, 快来和我聊天吧",
+        .tts_sync_type = TTS_SYNC_FROM_NET, .tts_text = "网络连接成功, 快来和我聊天吧", .sync_priority = 1,
     },
     [NOTIFY_CHAT_EXIT] = { 
         .notify_id = NOTIFY_CHAT_EXIT, .path = "chat_exit", .enable = 1, 
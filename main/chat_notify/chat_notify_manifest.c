@@ -0,0 +1,255 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "chat_notify_manifest.h"
+#include "qmsd_utils.h"
+
+#define TAG "chat_notify.manifest"
+
+#define MANIFEST_AUDIO_PATH "/littlefs"
+#define MANIFEST_TEMP_PATH "/littlefs/notify.tmp"
+#define MANIFEST_MAGIC 0x54464d4e  // "NMFT"
+#define MANIFEST_VERSION 1
+#define MANIFEST_READ_SIZE 512
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+} manifest_header_t;
+
+extern chat_notify_t chat_notify_list[];
+
+static chat_notify_asset_t manifest_assets[MAX_NOTIFY_TYPE];
+static SemaphoreHandle_t manifest_lock;
+
+// 文件名中 @ 或 . 之前的部分为通知的 path
+static int chat_notify_manifest_find_id(const char* name) {
+    uint32_t prefix_len = strcspn(name, "@.");
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        if (chat_notify_list[i].path && strlen(chat_notify_list[i].path) == prefix_len &&
+            strncmp(chat_notify_list[i].path, name, prefix_len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static esp_err_t chat_notify_manifest_file_info(const char* file_path, uint32_t* size, uint32_t* crc) {
+    FILE* fp = fopen(file_path, "rb");
+    if (fp == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t* buffer = qmsd_malloc(MANIFEST_READ_SIZE);
+    if (buffer == NULL) {
+        fclose(fp);
+        return ESP_ERR_NO_MEM;
+    }
+    *size = 0;
+    *crc = 0;
+    size_t len;
+    while ((len = fread(buffer, 1, MANIFEST_READ_SIZE, fp)) > 0) {
+        *crc = esp_rom_crc32_le(*crc, buffer, len);
+        *size += len;
+    }
+    qmsd_free(buffer);
+    fclose(fp);
+    return ESP_OK;
+}
+
+static esp_err_t chat_notify_manifest_save(void) {
+    manifest_header_t header = {
+        .magic = MANIFEST_MAGIC,
+        .version = MANIFEST_VERSION,
+        .count = 0,
+    };
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        header.count += manifest_assets[i].name[0] != '\0';
+    }
+
+    FILE* fp = fopen(MANIFEST_TEMP_PATH, "wb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "open %s failed", MANIFEST_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    bool ok = fwrite(&header, 1, sizeof(header), fp) == sizeof(header);
+    for (int i = 0; ok && i < MAX_NOTIFY_TYPE; i++) {
+        if (manifest_assets[i].name[0] != '\0') {
+            ok = fwrite(&manifest_assets[i], 1, sizeof(chat_notify_asset_t), fp) == sizeof(chat_notify_asset_t);
+        }
+    }
+    fclose(fp);
+    if (ok == false || rename(MANIFEST_TEMP_PATH, CHAT_NOTIFY_MANIFEST_PATH) != 0) {
+        ESP_LOGE(TAG, "save manifest failed");
+        remove(MANIFEST_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static bool chat_notify_manifest_load(void) {
+    FILE* fp = fopen(CHAT_NOTIFY_MANIFEST_PATH, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+
+    manifest_header_t header;
+    bool ok = fread(&header, 1, sizeof(header), fp) == sizeof(header);
+    ok = ok && header.magic == MANIFEST_MAGIC && header.version == MANIFEST_VERSION && header.count <= MAX_NOTIFY_TYPE;
+    chat_notify_asset_t* assets = NULL;
+    if (ok && header.count > 0) {
+        // 一次读出全部记录
+        assets = qmsd_malloc(header.count * sizeof(chat_notify_asset_t));
+        ok = assets && fread(assets, 1, header.count * sizeof(chat_notify_asset_t), fp) == header.count * sizeof(chat_notify_asset_t);
+    }
+    fclose(fp);
+
+    // 文件缺失或大小不符(写入中途掉电被截断)的记录丢弃，由同步任务重新下载
+    bool dropped = false;
+    char file_path[sizeof(MANIFEST_AUDIO_PATH) + CHAT_NOTIFY_ASSET_NAME_SIZE];
+    for (int i = 0; ok && i < header.count; i++) {
+        assets[i].name[CHAT_NOTIFY_ASSET_NAME_SIZE - 1] = '\0';
+        int id = chat_notify_manifest_find_id(assets[i].name);
+        if (id < 0) {
+            continue;
+        }
+        struct stat file_stat;
+        snprintf(file_path, sizeof(file_path), "%s/%s", MANIFEST_AUDIO_PATH, assets[i].name);
+        if (stat(file_path, &file_stat) != 0 || (uint32_t)file_stat.st_size != assets[i].size) {
+            ESP_LOGW(TAG, "%s missing or size mismatch, drop", assets[i].name);
+            dropped = true;
+            continue;
+        }
+        manifest_assets[id] = assets[i];
+    }
+    if (assets) {
+        qmsd_free(assets);
+    }
+    if (ok == false) {
+        ESP_LOGW(TAG, "manifest invalid, rebuild");
+        memset(manifest_assets, 0, sizeof(manifest_assets));
+    } else if (dropped) {
+        chat_notify_manifest_save();
+    }
+    return ok;
+}
+
+// 没有清单时扫描一次目录，记录每个通知的现有文件
+static void chat_notify_manifest_rebuild(void) {
+    DIR* dir = opendir(MANIFEST_AUDIO_PATH);
+    if (dir == NULL) {
+        ESP_LOGE(TAG, "Failed to open directory: %s", MANIFEST_AUDIO_PATH);
+        return;
+    }
+
+    char file_path[sizeof(MANIFEST_AUDIO_PATH) + CHAT_NOTIFY_ASSET_NAME_SIZE];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_type != DT_REG || strlen(entry->d_name) >= CHAT_NOTIFY_ASSET_NAME_SIZE) {
+            continue;
+        }
+        int id = chat_notify_manifest_find_id(entry->d_name);
+        if (id < 0 || chat_notify_list[id].tts_sync_type == TTS_SYNC_DISABLE) {
+            continue;
+        }
+        // 同一通知只保留一个版本，优先保留带 hashcode 的下载文件
+        const char* at_pos = strchr(entry->d_name, '@');
+        if (manifest_assets[id].name[0] != '\0' && at_pos == NULL) {
+            continue;
+        }
+
+        chat_notify_asset_t* asset = &manifest_assets[id];
+        snprintf(file_path, sizeof(file_path), "%s/%s", MANIFEST_AUDIO_PATH, entry->d_name);
+        if (chat_notify_manifest_file_info(file_path, &asset->size, &asset->crc) != ESP_OK) {
+            continue;
+        }
+        strcpy(asset->name, entry->d_name);
+        asset->hashcode = at_pos ? atoi(at_pos + 1) : 0;
+        ESP_LOGI(TAG, "found %s, size: %lu", asset->name, asset->size);
+    }
+    closedir(dir);
+    chat_notify_manifest_save();
+}
+
+void chat_notify_manifest_init(void) {
+    if (manifest_lock) {
+        return;
+    }
+    manifest_lock = xSemaphoreCreateMutex();
+    if (chat_notify_manifest_load() == false) {
+        chat_notify_manifest_rebuild();
+    }
+}
+
+bool chat_notify_manifest_get(chat_notify_status_t notify_id, chat_notify_asset_t* asset) {
+    if (notify_id >= MAX_NOTIFY_TYPE || manifest_lock == NULL || asset == NULL) {
+        return false;
+    }
+    xSemaphoreTake(manifest_lock, portMAX_DELAY);
+    *asset = manifest_assets[notify_id];
+    xSemaphoreGive(manifest_lock);
+    return asset->name[0] != '\0';
+}
+
+void chat_notify_manifest_verify(void) {
+    char file_path[sizeof(MANIFEST_AUDIO_PATH) + CHAT_NOTIFY_ASSET_NAME_SIZE];
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        chat_notify_asset_t asset;
+        if (chat_notify_manifest_get(i, &asset) == false) {
+            continue;
+        }
+        uint32_t size = 0;
+        uint32_t crc = 0;
+        snprintf(file_path, sizeof(file_path), "%s/%s", MANIFEST_AUDIO_PATH, asset.name);
+        if (chat_notify_manifest_file_info(file_path, &size, &crc) == ESP_ERR_NO_MEM ||
+            (size == asset.size && crc == asset.crc)) {
+            continue;
+        }
+
+        xSemaphoreTake(manifest_lock, portMAX_DELAY);
+        // 校验期间记录可能已被同步任务更新，只删除校验的那一份
+        bool same = memcmp(&manifest_assets[i], &asset, sizeof(asset)) == 0;
+        if (same) {
+            memset(&manifest_assets[i], 0, sizeof(chat_notify_asset_t));
+            chat_notify_manifest_save();
+        }
+        xSemaphoreGive(manifest_lock);
+        if (same) {
+            ESP_LOGW(TAG, "%s verify failed, drop", asset.name);
+            remove(file_path);
+        }
+    }
+}
+
+esp_err_t chat_notify_manifest_set(chat_notify_status_t notify_id, int hashcode, const char* file_path) {
+    if (notify_id >= MAX_NOTIFY_TYPE || file_path == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char* name = strrchr(file_path, '/');
+    name = name ? name + 1 : file_path;
+    if (strlen(name) >= CHAT_NOTIFY_ASSET_NAME_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    chat_notify_asset_t asset = { 0 };
+    esp_err_t err = chat_notify_manifest_file_info(file_path, &asset.size, &asset.crc);
+    if (err != ESP_OK) {
+        return err;
+    }
+    strcpy(asset.name, name);
+    asset.hashcode = hashcode;
+
+    xSemaphoreTake(manifest_lock, portMAX_DELAY);
+    manifest_assets[notify_id] = asset;
+    err = chat_notify_manifest_save();
+    xSemaphoreGive(manifest_lock);
+    return err;
+}
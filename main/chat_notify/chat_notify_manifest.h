@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "chat_notify.h"
+#include "esp_err.h"
+
+/** @brief 清单文件路径 */
+#define CHAT_NOTIFY_MANIFEST_PATH "/littlefs/notify.idx"
+/** @brief 清单中记录的文件名最大长度 */
+#define CHAT_NOTIFY_ASSET_NAME_SIZE 48
+
+/**
+ * @brief 提示音资源记录
+ * @note 以通知的 path 字段关联，通知枚举顺序变化不影响已有清单
+ */
+typedef struct {
+    char name[CHAT_NOTIFY_ASSET_NAME_SIZE];  // /littlefs 下的文件名，如 chat_wakeup@123.mp3
+    int32_t hashcode;                        // 生成该文件的音色 hashcode，随固件打包的文件为 0
+    uint32_t size;                           // 文件大小
+    uint32_t crc;                            // 文件内容 crc32
+} chat_notify_asset_t;
+
+/**
+ * @brief 加载提示音资源清单
+ * @note 开机时一次读取清单文件并检查文件大小；清单不存在时(首次升级到该版本或资源分区被重新烧录)
+ *       扫描一次 /littlefs 目录生成清单
+ */
+void chat_notify_manifest_init(void);
+
+/**
+ * @brief 获取通知对应的资源记录
+ * @param notify_id 通知ID
+ * @param asset 输出参数，在锁内拷贝出的资源记录
+ * @return true 有记录，false 没有记录
+ */
+bool chat_notify_manifest_get(chat_notify_status_t notify_id, chat_notify_asset_t* asset);
+
+/**
+ * @brief 按记录的大小和 crc 校验全部资源文件
+ * @note 读取全部文件，耗时较长，在后台任务中调用。不一致的记录和文件被删除，之后由同步任务重新下载。
+ *       加载清单时只比较文件大小，截断的文件在开机时就会被丢弃
+ */
+void chat_notify_manifest_verify(void);
+
+/**
+ * @brief 更新通知对应的资源记录
+ * @param notify_id 通知ID
+ * @param hashcode 音色 hashcode
+ * @param file_path 资源文件完整路径
+ * @return ESP_OK 成功，其他值表示失败
+ * @note 读取文件计算大小和 crc，清单通过临时文件 + rename 原子替换
+ */
+esp_err_t chat_notify_manifest_set(chat_notify_status_t notify_id, int hashcode, const char* file_path);
@@ -0,0 +1,310 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "aiha_audio_http.h"
+#include "chat_notify.h"
+#include "chat_notify_manifest.h"
+#include "chat_notify_sync.h"
+#include "http_pool.h"
+#include "qmsd_utils.h"
+
+#define TAG "chat_notify.sync"
+
+#define NOTIFY_SYNC_URL_SIZE 512
+#define NOTIFY_SYNC_PATH_SIZE 96
+#define NOTIFY_SYNC_BUFFER_SIZE 2048
+#define NOTIFY_SYNC_WAIT_MAX_MS 1000  // 没有到期的解析项时最长等待，及时发现音色变化和下载失败
+
+typedef enum {
+    SYNC_STATE_DONE = 0,
+    SYNC_STATE_RESOLVE,   // 等待请求 TTS 地址
+    SYNC_STATE_DOWNLOAD,  // 等待下载
+    SYNC_STATE_BUSY,      // 正在解析或下载
+} sync_state_t;
+
+typedef struct {
+    sync_state_t state;
+    uint8_t retry;
+    int64_t next_try_us;  // 退避结束时间
+    char* url;
+} sync_item_t;
+
+extern chat_notify_t chat_notify_list[];
+
+static sync_item_t sync_items[MAX_NOTIFY_TYPE];
+static int sync_hashcode = 0;
+static SemaphoreHandle_t sync_lock;
+static TaskHandle_t sync_download_handle;
+
+static void chat_notify_sync_tts_cb(const char* url, void* user_data) {
+    // 只需要地址，不播放
+}
+
+// 取出一个到期的最高优先级同步项，需持有 sync_lock
+static int chat_notify_sync_pick(sync_state_t state) {
+    int64_t now = esp_timer_get_time();
+    int pick = -1;
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        if (sync_items[i].state != state || sync_items[i].next_try_us > now) {
+            continue;
+        }
+        if (pick < 0 || chat_notify_list[i].sync_priority > chat_notify_list[pick].sync_priority) {
+            pick = i;
+        }
+    }
+    if (pick >= 0) {
+        sync_items[pick].state = SYNC_STATE_BUSY;
+    }
+    return pick;
+}
+
+// 失败后按指数退避回到 state 阶段，需持有 sync_lock
+static void chat_notify_sync_backoff(int index, sync_state_t state) {
+    uint32_t delay_ms = NOTIFY_SYNC_BACKOFF_MIN_MS << (sync_items[index].retry < 6 ? sync_items[index].retry : 6);
+    if (delay_ms > NOTIFY_SYNC_BACKOFF_MAX_MS) {
+        delay_ms = NOTIFY_SYNC_BACKOFF_MAX_MS;
+    }
+    sync_items[index].retry += 1;
+    sync_items[index].next_try_us = esp_timer_get_time() + delay_ms * 1000LL;
+    sync_items[index].state = state;
+    ESP_LOGW(TAG, "%s failed, retry in %lu ms", chat_notify_list[index].path, delay_ms);
+}
+
+// 下载到 .part 文件，已有部分内容时用 Range 续传
+static esp_err_t chat_notify_sync_download(const char* url, const char* part_path, char* buffer) {
+    struct stat file_stat;
+    long offset = stat(part_path, &file_stat) == 0 ? file_stat.st_size : 0;
+
+    esp_http_client_handle_t client = http_pool_acquire(url, 3000);
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+    if (offset > 0) {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%ld-", offset);
+        esp_http_client_set_header(client, "Range", range);
+        ESP_LOGI(TAG, "resume %s from %ld", part_path, offset);
+    }
+    if (http_pool_open(client, NULL) != ESP_OK) {
+        int status_code = esp_http_client_get_status_code(client);
+        http_pool_release(client, false);
+        // 4xx 说明地址已失效(或续传范围无效)，需要重新请求地址
+        return (status_code >= 400 && status_code < 500) ? ESP_ERR_NOT_FOUND : ESP_FAIL;
+    }
+
+    // 服务器不支持 Range 时返回 200，从头写
+    bool append = offset > 0 && esp_http_client_get_status_code(client) == 206;
+    FILE* fp = fopen(part_path, append ? "ab" : "wb");
+    if (fp == NULL) {
+        http_pool_release(client, false);
+        return ESP_FAIL;
+    }
+
+    bool complete = false;
+    for (;;) {
+        int len = esp_http_client_read(client, buffer, NOTIFY_SYNC_BUFFER_SIZE);
+        if (len < 0) {
+            break;
+        }
+        if (len == 0) {
+            complete = esp_http_client_is_complete_data_received(client);
+            break;
+        }
+        if (fwrite(buffer, 1, len, fp) != (size_t)len) {
+            ESP_LOGE(TAG, "write %s failed", part_path);
+            break;
+        }
+    }
+    fclose(fp);
+    http_pool_release(client, complete);
+    return complete ? ESP_OK : ESP_FAIL;
+}
+
+// 下载完成后替换为正式文件，先记录清单再删除旧文件
+// rename 和清单计算 crc 需要读整个文件，不持有 sync_lock 调用，通知状态由调用者在锁内更新
+static esp_err_t chat_notify_sync_commit(int index, int hashcode, const char* part_path) {
+    chat_notify_t* notify = &chat_notify_list[index];
+    char file_path[NOTIFY_SYNC_PATH_SIZE];
+    char old_path[NOTIFY_SYNC_PATH_SIZE] = { 0 };
+
+    NOTIFY_PATH_COVER(notify->path, hashcode, file_path);
+    if (rename(part_path, file_path) != 0) {
+        ESP_LOGE(TAG, "rename %s failed", part_path);
+        return ESP_FAIL;
+    }
+
+    chat_notify_asset_t asset;
+    if (chat_notify_manifest_get(index, &asset) && strcmp(asset.name, file_path + sizeof(NOTIFY_AUDIO_PATH)) != 0) {
+        sprintf(old_path, "%s/%s", NOTIFY_AUDIO_PATH, asset.name);
+    }
+    chat_notify_manifest_set(index, hashcode, file_path);
+    if (old_path[0] != '\0') {
+        remove(old_path);
+    }
+    ESP_LOGI(TAG, "success update tts file: %s", file_path);
+    return ESP_OK;
+}
+
+static void chat_notify_sync_download_task(void* arg) {
+    char* url = qmsd_malloc(NOTIFY_SYNC_URL_SIZE);
+    char* buffer = qmsd_malloc(NOTIFY_SYNC_BUFFER_SIZE);
+    char part_path[NOTIFY_SYNC_PATH_SIZE];
+
+    for (;;) {
+        xSemaphoreTake(sync_lock, portMAX_DELAY);
+        int index = chat_notify_sync_pick(SYNC_STATE_DOWNLOAD);
+        int hashcode = sync_hashcode;
+        if (index >= 0) {
+            strcpy(url, sync_items[index].url);
+        }
+        xSemaphoreGive(sync_lock);
+
+        if (index < 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000));
+            continue;
+        }
+
+        NOTIFY_PATH_COVER(chat_notify_list[index].path, hashcode, part_path);
+        strcat(part_path, ".part");
+        esp_err_t err = chat_notify_sync_download(url, part_path, buffer);
+
+        xSemaphoreTake(sync_lock, portMAX_DELAY);
+        bool stale = hashcode != sync_hashcode;
+        xSemaphoreGive(sync_lock);
+        if (stale) {
+            // 下载期间音色已变化，结果作废
+            remove(part_path);
+            continue;
+        }
+        if (err == ESP_OK) {
+            err = chat_notify_sync_commit(index, hashcode, part_path);
+            if (err != ESP_OK) {
+                // 文件不完整或无法替换，重新下载
+                remove(part_path);
+            }
+        }
+
+        xSemaphoreTake(sync_lock, portMAX_DELAY);
+        if (hashcode != sync_hashcode) {
+            // 替换期间音色已变化，同步项已被重置；清单中的旧音色文件之后由新音色的下载替换
+            xSemaphoreGive(sync_lock);
+            continue;
+        }
+        if (err == ESP_OK) {
+            chat_notify_t* notify = &chat_notify_list[index];
+            notify->file_exist = 1;
+            if (notify->path_temp) {
+                free(notify->path_temp);
+                notify->path_temp = NULL;
+            }
+            qmsd_free(sync_items[index].url);
+            sync_items[index].url = NULL;
+            sync_items[index].state = SYNC_STATE_DONE;
+        } else if (err == ESP_ERR_NOT_FOUND) {
+            // 重新解析会得到新地址，旧地址在这里释放
+            remove(part_path);
+            qmsd_free(sync_items[index].url);
+            sync_items[index].url = NULL;
+            chat_notify_sync_backoff(index, SYNC_STATE_RESOLVE);
+        } else {
+            chat_notify_sync_backoff(index, SYNC_STATE_DOWNLOAD);
+        }
+        xSemaphoreGive(sync_lock);
+    }
+}
+
+void chat_notify_sync_reset(int hashcode) {
+    if (sync_lock == NULL) {
+        sync_lock = xSemaphoreCreateMutex();
+        qmsd_thread_create(chat_notify_sync_download_task, "notify_download", 4 * 1024, NULL, 4, &sync_download_handle, 0, 1);
+    }
+
+    xSemaphoreTake(sync_lock, portMAX_DELAY);
+    sync_hashcode = hashcode;
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        chat_notify_t* notify = &chat_notify_list[i];
+        if (sync_items[i].url) {
+            qmsd_free(sync_items[i].url);
+        }
+        memset(&sync_items[i], 0, sizeof(sync_item_t));
+
+        if (notify->enable == 0) {
+            continue;
+        }
+        if (notify->tts_sync_type == TTS_SYNC_DISABLE) {
+            notify->file_exist = 1;
+            continue;
+        }
+        // 清单中的文件就是当前音色生成的，不需要再访问文件系统
+        chat_notify_asset_t asset;
+        notify->file_exist = chat_notify_manifest_get(i, &asset) && asset.hashcode == hashcode;
+        if (notify->file_exist == 0) {
+            sync_items[i].state = SYNC_STATE_RESOLVE;
+        }
+    }
+    xSemaphoreGive(sync_lock);
+}
+
+bool chat_notify_sync_resolve(uint32_t* wait_ms) {
+    *wait_ms = 0;
+    if (sync_lock == NULL) {
+        return false;
+    }
+
+    bool pending = false;
+    int64_t next_try_us = INT64_MAX;
+    xSemaphoreTake(sync_lock, portMAX_DELAY);
+    int index = chat_notify_sync_pick(SYNC_STATE_RESOLVE);
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        pending = pending || sync_items[i].state != SYNC_STATE_DONE;
+        if (sync_items[i].state == SYNC_STATE_RESOLVE && sync_items[i].next_try_us < next_try_us) {
+            next_try_us = sync_items[i].next_try_us;
+        }
+    }
+    int hashcode = sync_hashcode;
+    xSemaphoreGive(sync_lock);
+    if (index < 0) {
+        // 全部在退避或下载中，等到最早的退避结束
+        int64_t wait_us = next_try_us - esp_timer_get_time();
+        *wait_ms = wait_us < NOTIFY_SYNC_WAIT_MAX_MS * 1000LL ? wait_us / 1000 + 1 : NOTIFY_SYNC_WAIT_MAX_MS;
+        return pending;
+    }
+
+    char* url = qmsd_malloc(NOTIFY_SYNC_URL_SIZE);
+    bool ok = url != NULL;
+    if (ok) {
+        url[0] = '\0';
+        ok = aiha_request_tts(chat_notify_list[index].tts_text, chat_notify_sync_tts_cb, url, NULL) && url[0] != '\0';
+    }
+
+    xSemaphoreTake(sync_lock, portMAX_DELAY);
+    if (hashcode != sync_hashcode) {
+        ok = false;
+    } else if (ok) {
+        // 新地址的内容不一定与旧的 .part 一致，不续传
+        char part_path[NOTIFY_SYNC_PATH_SIZE];
+        NOTIFY_PATH_COVER(chat_notify_list[index].path, hashcode, part_path);
+        strcat(part_path, ".part");
+        remove(part_path);
+        sync_items[index].url = url;
+        sync_items[index].state = SYNC_STATE_DOWNLOAD;
+    } else {
+        chat_notify_sync_backoff(index, SYNC_STATE_RESOLVE);
+    }
+    xSemaphoreGive(sync_lock);
+
+    if (ok) {
+        xTaskNotifyGive(sync_download_handle);
+    } else if (url) {
+        qmsd_free(url);
+    }
+    return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief 失败重试的初始间隔(ms)，每次失败翻倍 */
+#define NOTIFY_SYNC_BACKOFF_MIN_MS 1000
+/** @brief 失败重试的最大间隔(ms) */
+#define NOTIFY_SYNC_BACKOFF_MAX_MS 60000
+
+/**
+ * @brief 按音色重新生成待同步列表
+ * @param hashcode 当前音色的 tts hashcode
+ * @note 清单中不是该音色生成的通知都会加入列表；首次调用时创建下载任务
+ */
+void chat_notify_sync_reset(int hashcode);
+
+/**
+ * @brief 解析一个待同步通知的音频地址
+ * @param wait_ms 输出参数，下次调用前需要等待的时间(ms)，全部处于退避时为最早的退避结束时间
+ * @return true 还有未完成的同步项，false 全部同步完成
+ * @note 在通知同步任务中循环调用，按 sync_priority 从高到低，每次最多请求一次 TTS 地址，
+ *       得到地址后交给下载任务；解析和下载分两个阶段并行，下载经过 http_pool 复用 keep-alive 连接
+ */
+bool chat_notify_sync_resolve(uint32_t* wait_ms);
@@ -0,0 +1,276 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+
+#include "aiha_audio_http.h"
+#include "audio_player_user.h"
+#include "chat_phrase.h"
+#include "chat_player.h"
+
+#define TAG "chat_phrase"
+
+#define PHRASE_AUDIO_PATH "/littlefs"
+#define PHRASE_TEMP_FILE_PATH "/littlefs/phrase_temp.mp3"
+#define PHRASE_FILE_PATH_SIZE 64
+#define PHRASE_MANIFEST_PATH "/littlefs/phrase.idx"
+#define PHRASE_MANIFEST_TEMP_PATH "/littlefs/phrase.tmp"
+#define PHRASE_MANIFEST_MAGIC 0x54464d50  // "PMFT"
+
+#define PHRASE_PATH_COVER(key, hashcode, file_path)                                                          \
+    do {                                                                                                     \
+        snprintf(file_path, PHRASE_FILE_PATH_SIZE, "%s/phrase_%s@%d.mp3", PHRASE_AUDIO_PATH, key, hashcode); \
+    } while (0)
+
+typedef enum {
+    PHRASE_VOL_SET,
+    PHRASE_NUM_0,
+    PHRASE_NUM_9 = PHRASE_NUM_0 + 9,
+    PHRASE_NUM_TEN,
+    PHRASE_NUM_HUNDRED,
+    PHRASE_MAX,
+} chat_phrase_id_t;
+
+typedef struct {
+    const char* key;   // 文件名关键字
+    const char* text;  // 片段文本
+    uint8_t file_exist;
+} chat_phrase_t;
+
+// 片段清单，按 phrase_list 的顺序记录每个片段已保存文件的音色和大小，hashcode 为 0 表示没有文件
+typedef struct {
+    int32_t hashcode;
+    uint32_t size;
+} chat_phrase_asset_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t count;
+    uint16_t reserved;
+    chat_phrase_asset_t assets[PHRASE_MAX];
+} chat_phrase_manifest_t;
+
+static chat_phrase_t phrase_list[PHRASE_MAX] = {
+    [PHRASE_VOL_SET] = { .key = "vol_set", .text = "音量已设置为" },
+    [PHRASE_NUM_0 + 0] = { .key = "n0", .text = "零" },
+    [PHRASE_NUM_0 + 1] = { .key = "n1", .text = "一" },
+    [PHRASE_NUM_0 + 2] = { .key = "n2", .text = "二" },
+    [PHRASE_NUM_0 + 3] = { .key = "n3", .text = "三" },
+    [PHRASE_NUM_0 + 4] = { .key = "n4", .text = "四" },
+    [PHRASE_NUM_0 + 5] = { .key = "n5", .text = "五" },
+    [PHRASE_NUM_0 + 6] = { .key = "n6", .text = "六" },
+    [PHRASE_NUM_0 + 7] = { .key = "n7", .text = "七" },
+    [PHRASE_NUM_0 + 8] = { .key = "n8", .text = "八" },
+    [PHRASE_NUM_0 + 9] = { .key = "n9", .text = "九" },
+    [PHRASE_NUM_TEN] = { .key = "n10", .text = "十" },
+    [PHRASE_NUM_HUNDRED] = { .key = "n100", .text = "百" },
+};
+
+static chat_phrase_manifest_t phrase_manifest;
+static int phrase_hashcode = 0;
+static bool phrase_checked = false;
+
+// 0~100 转换为片段: 7 -> 七, 15 -> 十五, 30 -> 三十, 100 -> 一百
+static uint8_t chat_phrase_number_pieces(uint32_t value, uint8_t* pieces) {
+    uint8_t num = 0;
+    if (value == 100) {
+        pieces[num++] = PHRASE_NUM_0 + 1;
+        pieces[num++] = PHRASE_NUM_HUNDRED;
+    } else if (value >= 10) {
+        if (value >= 20) {
+            pieces[num++] = PHRASE_NUM_0 + value / 10;
+        }
+        pieces[num++] = PHRASE_NUM_TEN;
+        if (value % 10) {
+            pieces[num++] = PHRASE_NUM_0 + value % 10;
+        }
+    } else {
+        pieces[num++] = PHRASE_NUM_0 + value;
+    }
+    return num;
+}
+
+// 把文本拆成片段序列，遇到无法识别的文字返回 0
+static uint8_t chat_phrase_split(const char* text, uint8_t* pieces) {
+    uint8_t num = 0;
+    const char* p = text;
+    while (*p) {
+        if (*p == ' ') {
+            p++;
+            continue;
+        }
+        if (num + 3 > CHAT_PHRASE_PIECE_MAX) {
+            return 0;
+        }
+
+        if (*p >= '0' && *p <= '9') {
+            uint32_t value = 0;
+            while (*p >= '0' && *p <= '9' && value <= 100) {
+                value = value * 10 + (*p - '0');
+                p++;
+            }
+            if (value > 100) {
+                return 0;
+            }
+            num += chat_phrase_number_pieces(value, &pieces[num]);
+            continue;
+        }
+
+        bool matched = false;
+        for (int i = 0; i < PHRASE_MAX; i++) {
+            uint32_t len = strlen(phrase_list[i].text);
+            if (strncmp(p, phrase_list[i].text, len) == 0) {
+                pieces[num++] = i;
+                p += len;
+                matched = true;
+                break;
+            }
+        }
+        if (matched == false) {
+            return 0;
+        }
+    }
+    return num;
+}
+
+static esp_err_t chat_phrase_manifest_save(void) {
+    FILE* fp = fopen(PHRASE_MANIFEST_TEMP_PATH, "wb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "open %s failed", PHRASE_MANIFEST_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    bool ok = fwrite(&phrase_manifest, 1, sizeof(phrase_manifest), fp) == sizeof(phrase_manifest);
+    fclose(fp);
+    if (ok == false || rename(PHRASE_MANIFEST_TEMP_PATH, PHRASE_MANIFEST_PATH) != 0) {
+        ESP_LOGE(TAG, "save manifest failed");
+        remove(PHRASE_MANIFEST_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// 没有清单时(首次升级到该版本)扫描一次目录，删除之前版本留下的全部片段，之后按清单清理
+static void chat_phrase_manifest_reset(void) {
+    DIR* dir = opendir(PHRASE_AUDIO_PATH);
+    if (dir) {
+        char file_path[PHRASE_FILE_PATH_SIZE];
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            if (entry->d_type == DT_REG && strncmp(entry->d_name, "phrase_", strlen("phrase_")) == 0) {
+                snprintf(file_path, sizeof(file_path), "%s/%s", PHRASE_AUDIO_PATH, entry->d_name);
+                remove(file_path);
+            }
+        }
+        closedir(dir);
+    }
+    memset(&phrase_manifest, 0, sizeof(phrase_manifest));
+    phrase_manifest.magic = PHRASE_MANIFEST_MAGIC;
+    phrase_manifest.count = PHRASE_MAX;
+    chat_phrase_manifest_save();
+}
+
+static void chat_phrase_manifest_load(void) {
+    FILE* fp = fopen(PHRASE_MANIFEST_PATH, "rb");
+    bool ok = fp && fread(&phrase_manifest, 1, sizeof(phrase_manifest), fp) == sizeof(phrase_manifest);
+    if (fp) {
+        fclose(fp);
+    }
+    // 片段表变化后清单失效，按没有清单处理
+    if (ok == false || phrase_manifest.magic != PHRASE_MANIFEST_MAGIC || phrase_manifest.count != PHRASE_MAX) {
+        ESP_LOGW(TAG, "manifest missing or invalid, reset");
+        chat_phrase_manifest_reset();
+    }
+}
+
+esp_err_t chat_phrase_sync(int hashcode) {
+    char file_path[PHRASE_FILE_PATH_SIZE];
+    struct stat file_stat;
+
+    if (phrase_manifest.magic != PHRASE_MANIFEST_MAGIC) {
+        chat_phrase_manifest_load();
+    }
+    if (hashcode != phrase_hashcode) {
+        phrase_hashcode = hashcode;
+        phrase_checked = false;
+    }
+
+    // 音色变化后按清单检查已有文件，并删除旧音色的片段，不扫描目录
+    if (phrase_checked == false) {
+        bool changed = false;
+        for (int i = 0; i < PHRASE_MAX; i++) {
+            chat_phrase_asset_t* asset = &phrase_manifest.assets[i];
+            phrase_list[i].file_exist = 0;
+            if (asset->hashcode == 0) {
+                continue;
+            }
+            PHRASE_PATH_COVER(phrase_list[i].key, asset->hashcode, file_path);
+            if (asset->hashcode == hashcode && stat(file_path, &file_stat) == 0 && (uint32_t)file_stat.st_size == asset->size) {
+                phrase_list[i].file_exist = 1;
+                continue;
+            }
+            remove(file_path);
+            memset(asset, 0, sizeof(chat_phrase_asset_t));
+            changed = true;
+        }
+        if (changed) {
+            chat_phrase_manifest_save();
+        }
+        phrase_checked = true;
+    }
+
+    for (int i = 0; i < PHRASE_MAX; i++) {
+        if (phrase_list[i].file_exist) {
+            continue;
+        }
+        if (aiha_tts_download_audio_to_file(phrase_list[i].text, PHRASE_TEMP_FILE_PATH) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        PHRASE_PATH_COVER(phrase_list[i].key, hashcode, file_path);
+        if (rename(PHRASE_TEMP_FILE_PATH, file_path) != 0 || stat(file_path, &file_stat) != 0) {
+            ESP_LOGE(TAG, "rename %s failed", file_path);
+            remove(PHRASE_TEMP_FILE_PATH);
+            remove(file_path);
+            return ESP_FAIL;
+        }
+        // 先记入清单再标记可用，清单写入失败时删除文件，避免留下清单之外的片段
+        phrase_manifest.assets[i].hashcode = hashcode;
+        phrase_manifest.assets[i].size = file_stat.st_size;
+        if (chat_phrase_manifest_save() != ESP_OK) {
+            memset(&phrase_manifest.assets[i], 0, sizeof(chat_phrase_asset_t));
+            remove(file_path);
+            return ESP_FAIL;
+        }
+        phrase_list[i].file_exist = 1;
+        ESP_LOGI(TAG, "success update phrase file: %s", file_path);
+        return ESP_OK;
+    }
+    return ESP_OK;
+}
+
+bool chat_phrase_play(const char* text) {
+    uint8_t pieces[CHAT_PHRASE_PIECE_MAX];
+    char paths[CHAT_PHRASE_PIECE_MAX][PHRASE_FILE_PATH_SIZE];
+    const char* path_list[CHAT_PHRASE_PIECE_MAX];
+
+    if (text == NULL || phrase_checked == false) {
+        return false;
+    }
+
+    uint8_t num = chat_phrase_split(text, pieces);
+    if (num == 0) {
+        return false;
+    }
+    for (int i = 0; i < num; i++) {
+        if (phrase_list[pieces[i]].file_exist == 0) {
+            ESP_LOGI(TAG, "phrase %s not ready", phrase_list[pieces[i]].key);
+            return false;
+        }
+        PHRASE_PATH_COVER(phrase_list[pieces[i]].key, phrase_hashcode, paths[i]);
+        path_list[i] = paths[i];
+    }
+
+    ESP_LOGI(TAG, "play phrase: %s, pieces: %d", text, num);
+    return chat_player_play_files(path_list, num);
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 一句话最多拼接的片段数量 */
+#define CHAT_PHRASE_PIECE_MAX 8
+
+/**
+ * @brief 同步短语片段文件
+ * @param hashcode 当前音色的 tts hashcode
+ * @return ESP_OK 片段已就绪或本次下载成功，ESP_FAIL 下载失败
+ * @note 在通知同步任务中循环调用，每次最多下载一个片段，片段保存为 /littlefs/phrase_<key>@<hashcode>.mp3，
+ *       文件记录在 /littlefs/phrase.idx 清单中，音色变化后按清单删除旧的片段文件，不扫描目录
+ */
+esp_err_t chat_phrase_sync(int hashcode);
+
+/**
+ * @brief 用本地片段拼接播放一句话
+ * @param text 回答文本，由固定短语和 0~100 的数字组成，如 "音量已设置为 35"
+ * @return true 已开始本地播放，false 无法拼接(含未知文字或片段未下载)，需要走云端 TTS
+ * @note 片段在播放时按帧边界拼接写入 raw 流，不需要网络
+ */
+bool chat_phrase_play(const char* text);
@@ -0,0 +1,181 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "prompt_bank.h"
+#include "qmsd_utils.h"
+
+#define TAG "prompt_bank"
+
+#define PROMPT_BANK_COPY_SIZE 1024
+#define PROMPT_BANK_ALIGN_UP(x) (((x) + PROMPT_BANK_ALIGN - 1) & ~(PROMPT_BANK_ALIGN - 1))
+
+static const esp_partition_t* bank_partition;
+static const uint8_t* bank_map;
+static esp_partition_mmap_handle_t bank_map_handle;
+static SemaphoreHandle_t bank_lock;
+static bool bank_valid = false;
+
+static bool prompt_bank_check(void) {
+    const prompt_bank_header_t* header = (const prompt_bank_header_t*)bank_map;
+    if (header->magic != PROMPT_BANK_MAGIC || header->version != PROMPT_BANK_VERSION || header->count > PROMPT_BANK_ENTRY_MAX) {
+        return false;
+    }
+    const prompt_bank_entry_t* entries = (const prompt_bank_entry_t*)(header + 1);
+    for (int i = 0; i < header->count; i++) {
+        if (entries[i].offset + entries[i].size > bank_partition->size) {
+            ESP_LOGE(TAG, "entry %.*s out of range", PROMPT_BANK_ID_SIZE, entries[i].id);
+            return false;
+        }
+        // 逐条校验音频数据，任何一条损坏都按无效处理，提示音改走文件或 TTS
+        if (esp_rom_crc32_le(0, bank_map + entries[i].offset, entries[i].size) != entries[i].crc) {
+            ESP_LOGE(TAG, "entry %.*s crc mismatch", PROMPT_BANK_ID_SIZE, entries[i].id);
+            return false;
+        }
+    }
+    return true;
+}
+
+esp_err_t prompt_bank_init(void) {
+    if (bank_lock) {
+        return bank_valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+    }
+    bank_lock = xSemaphoreCreateMutex();
+    bank_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PROMPT_BANK_PARTITION);
+    if (bank_partition == NULL) {
+        ESP_LOGW(TAG, "no %s partition", PROMPT_BANK_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = esp_partition_mmap(bank_partition, 0, bank_partition->size, ESP_PARTITION_MMAP_DATA, (const void**)&bank_map, &bank_map_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(err));
+        bank_partition = NULL;
+        return err;
+    }
+    bank_valid = prompt_bank_check();
+    ESP_LOGI(TAG, "prompt bank %s, entries: %d", bank_valid ? "valid" : "invalid", bank_valid ? ((const prompt_bank_header_t*)bank_map)->count : 0);
+    return bank_valid ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+// 调用者需持有 bank_lock，返回的条目指向映射的 flash，只能在锁内使用
+static const prompt_bank_entry_t* prompt_bank_lookup(const char* id) {
+    if (bank_valid == false || id == NULL) {
+        return NULL;
+    }
+    const prompt_bank_header_t* header = (const prompt_bank_header_t*)bank_map;
+    const prompt_bank_entry_t* entries = (const prompt_bank_entry_t*)(header + 1);
+    for (int i = 0; i < header->count; i++) {
+        if (strncmp(entries[i].id, id, PROMPT_BANK_ID_SIZE) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool prompt_bank_find(const char* id, prompt_bank_entry_t* entry) {
+    if (bank_lock == NULL || entry == NULL) {
+        return false;
+    }
+    xSemaphoreTake(bank_lock, portMAX_DELAY);
+    const prompt_bank_entry_t* found = prompt_bank_lookup(id);
+    if (found) {
+        *entry = *found;
+    }
+    xSemaphoreGive(bank_lock);
+    return found != NULL;
+}
+
+bool prompt_bank_acquire(const char* id, const uint8_t** data, uint32_t* size) {
+    if (bank_lock == NULL) {
+        return false;
+    }
+    xSemaphoreTake(bank_lock, portMAX_DELAY);
+    const prompt_bank_entry_t* entry = prompt_bank_lookup(id);
+    if (entry == NULL) {
+        xSemaphoreGive(bank_lock);
+        return false;
+    }
+    *data = bank_map + entry->offset;
+    *size = entry->size;
+    return true;
+}
+
+void prompt_bank_release(void) {
+    xSemaphoreGive(bank_lock);
+}
+
+// 从文件拷贝到分区，同时计算 crc
+static esp_err_t prompt_bank_copy_file(const char* file_path, uint32_t offset, uint32_t* size, uint32_t* crc, uint8_t* buffer) {
+    FILE* fp = fopen(file_path, "rb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "open %s failed", file_path);
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = ESP_OK;
+    *size = 0;
+    *crc = 0;
+    size_t len;
+    while ((len = fread(buffer, 1, PROMPT_BANK_COPY_SIZE, fp)) > 0) {
+        if (offset + *size + len > bank_partition->size) {
+            err = ESP_ERR_INVALID_SIZE;
+            break;
+        }
+        err = esp_partition_write(bank_partition, offset + *size, buffer, len);
+        if (err != ESP_OK) {
+            break;
+        }
+        *crc = esp_rom_crc32_le(*crc, buffer, len);
+        *size += len;
+    }
+    fclose(fp);
+    return err;
+}
+
+esp_err_t prompt_bank_pack(const prompt_bank_src_t* src, uint8_t num) {
+    if (bank_partition == NULL || src == NULL || num > PROMPT_BANK_ENTRY_MAX) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    prompt_bank_entry_t* entries = qmsd_malloc(num * sizeof(prompt_bank_entry_t));
+    uint8_t* buffer = qmsd_malloc(PROMPT_BANK_COPY_SIZE);
+    if (entries == NULL || buffer == NULL) {
+        qmsd_free(entries);
+        qmsd_free(buffer);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(entries, 0, num * sizeof(prompt_bank_entry_t));
+
+    xSemaphoreTake(bank_lock, portMAX_DELAY);
+    bank_valid = false;
+    esp_err_t err = esp_partition_erase_range(bank_partition, 0, bank_partition->size);
+    uint32_t offset = PROMPT_BANK_ALIGN_UP(sizeof(prompt_bank_header_t) + num * sizeof(prompt_bank_entry_t));
+    for (int i = 0; i < num && err == ESP_OK; i++) {
+        strncpy(entries[i].id, src[i].id, PROMPT_BANK_ID_SIZE - 1);
+        entries[i].hashcode = src[i].hashcode;
+        entries[i].offset = offset;
+        err = prompt_bank_copy_file(src[i].file_path, offset, &entries[i].size, &entries[i].crc, buffer);
+        offset = PROMPT_BANK_ALIGN_UP(offset + entries[i].size);
+    }
+    if (err == ESP_OK) {
+        err = esp_partition_write(bank_partition, sizeof(prompt_bank_header_t), entries, num * sizeof(prompt_bank_entry_t));
+    }
+    if (err == ESP_OK) {
+        prompt_bank_header_t header = {
+            .magic = PROMPT_BANK_MAGIC,
+            .version = PROMPT_BANK_VERSION,
+            .count = num,
+        };
+        err = esp_partition_write(bank_partition, 0, &header, sizeof(header));
+    }
+    bank_valid = err == ESP_OK && prompt_bank_check();
+    xSemaphoreGive(bank_lock);
+
+    ESP_LOGI(TAG, "pack %d prompts, used %lu bytes: %s", num, offset, esp_err_to_name(err));
+    qmsd_free(entries);
+    qmsd_free(buffer);
+    return err;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 提示音库分区名称 */
+#define PROMPT_BANK_PARTITION "bank"
+/** @brief 提示音库格式标识 "QBNK" */
+#define PROMPT_BANK_MAGIC 0x4b4e4251
+#define PROMPT_BANK_VERSION 1
+/** @brief 音频数据在分区中的对齐字节数 */
+#define PROMPT_BANK_ALIGN 16
+/** @brief 提示音名称最大长度(含结束符) */
+#define PROMPT_BANK_ID_SIZE 24
+/** @brief 提示音最大数量 */
+#define PROMPT_BANK_ENTRY_MAX 16
+
+/**
+ * @brief 提示音库头部，位于分区起始处，后面紧跟 count 个 prompt_bank_entry_t
+ * @note 格式与 main/tools/mkbank.py 保持一致，全部为小端
+ */
+typedef struct {
+    uint32_t magic;    // PROMPT_BANK_MAGIC，最后写入，作为整库写入完成的标志
+    uint16_t version;  // PROMPT_BANK_VERSION
+    uint16_t count;    // 索引条目数量
+} prompt_bank_header_t;
+
+/**
+ * @brief 提示音库索引条目
+ */
+typedef struct {
+    char id[PROMPT_BANK_ID_SIZE];  // 提示音名称，与通知的 path 相同
+    int32_t hashcode;              // 生成该音频的音色 hashcode，0 表示与音色无关
+    uint32_t offset;               // 音频数据相对分区起始的偏移，按 PROMPT_BANK_ALIGN 对齐
+    uint32_t size;                 // 音频数据长度
+    uint32_t crc;                  // 音频数据 crc32
+} prompt_bank_entry_t;
+
+/**
+ * @brief 打包时的源文件
+ */
+typedef struct {
+    const char* id;         // 提示音名称
+    int32_t hashcode;       // 音色 hashcode
+    const char* file_path;  // 源 mp3 文件路径
+} prompt_bank_src_t;
+
+/**
+ * @brief 映射提示音库分区
+ * @return ESP_OK 成功，ESP_ERR_NOT_FOUND 没有该分区，ESP_ERR_INVALID_STATE 分区内容无效
+ * @note 整个分区通过 esp_partition_mmap 映射，播放时直接从 flash 读取，不经过文件系统。
+ *       初始化时校验每条音频的 crc，有损坏时整库视为无效
+ */
+esp_err_t prompt_bank_init(void);
+
+/**
+ * @brief 查找提示音
+ * @param id 提示音名称
+ * @param entry 输出参数，在锁内拷贝出的索引条目
+ * @return true 有该提示音，false 没有
+ * @note 只拷贝索引，之后读取音频数据需要用 prompt_bank_acquire
+ */
+bool prompt_bank_find(const char* id, prompt_bank_entry_t* entry);
+
+/**
+ * @brief 锁定提示音库并获取提示音数据
+ * @param id 提示音名称
+ * @param data 输出参数，映射后的音频数据地址
+ * @param size 输出参数，音频数据长度
+ * @return true 成功，此时必须在读取结束后调用 prompt_bank_release；false 没有该提示音
+ * @note 锁定期间 prompt_bank_pack 会等待，保证读取的数据不被改写
+ */
+bool prompt_bank_acquire(const char* id, const uint8_t** data, uint32_t* size);
+
+/**
+ * @brief 释放 prompt_bank_acquire 的锁定
+ */
+void prompt_bank_release(void);
+
+/**
+ * @brief 用文件重新打包提示音库
+ * @param src 源文件列表
+ * @param num 源文件数量
+ * @return ESP_OK 成功，其他值表示失败，失败后提示音库为空
+ * @note 擦除分区后先写音频和索引，最后写头部 magic，掉电时提示音库视为无效而不是损坏
+ */
+esp_err_t prompt_bank_pack(const prompt_bank_src_t* src, uint8_t num);
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+
+#include "audio_hardware.h"
+#include "esp_adpcm_dec.h"
+#include "esp_adpcm_enc.h"
+#include "esp_mp3_dec.h"
+#include "prompt_pcm.h"
+#include "qmsd_utils.h"
+
+#define TAG "prompt_pcm"
+
+#define PROMPT_PCM_PATH_SIZE 72
+#define PROMPT_PCM_DECODE_SIZE 4608  // 一帧 mp3 解码后的最大 PCM 长度
+#define PROMPT_PCM_WRITE_SIZE 1024
+
+typedef struct {
+    FILE* fp;
+    void* enc;          // ADPCM 编码器，PCM 格式时为 NULL
+    uint8_t* in;        // 编码器输入缓冲，凑满一帧再编码
+    int in_size;
+    int in_fill;
+    uint8_t* out;
+    int out_size;
+    uint16_t block_size;
+    uint32_t data_size;
+    bool ok;
+} prompt_pcm_writer_t;
+
+static uint32_t prompt_pcm_skip_id3(const uint8_t* data, uint32_t size) {
+    uint32_t offset = 0;
+    if (size >= 10 && memcmp(data, "ID3", 3) == 0) {
+        offset = ((data[6] & 0x7f) << 21) | ((data[7] & 0x7f) << 14) | ((data[8] & 0x7f) << 7) | (data[9] & 0x7f);
+        offset += (data[5] & 0x10) ? 20 : 10;
+    }
+    return offset < size ? offset : size;
+}
+
+static void prompt_pcm_writer_encode(prompt_pcm_writer_t* writer) {
+    esp_audio_enc_in_frame_t in_frame = { .buffer = writer->in, .len = writer->in_size };
+    esp_audio_enc_out_frame_t out_frame = { .buffer = writer->out, .len = writer->out_size };
+    if (esp_adpcm_enc_process(writer->enc, &in_frame, &out_frame) != ESP_AUDIO_ERR_OK) {
+        writer->ok = false;
+        return;
+    }
+    if (writer->block_size == 0) {
+        writer->block_size = out_frame.encoded_bytes;
+    }
+    writer->ok = writer->ok && fwrite(writer->out, 1, out_frame.encoded_bytes, writer->fp) == out_frame.encoded_bytes;
+    writer->data_size += out_frame.encoded_bytes;
+    writer->in_fill = 0;
+}
+
+static void prompt_pcm_writer_write(prompt_pcm_writer_t* writer, const uint8_t* data, uint32_t len) {
+    if (writer->enc == NULL) {
+        writer->ok = writer->ok && fwrite(data, 1, len, writer->fp) == len;
+        writer->data_size += len;
+        return;
+    }
+    while (len > 0 && writer->ok) {
+        uint32_t copy = writer->in_size - writer->in_fill;
+        copy = copy < len ? copy : len;
+        memcpy(writer->in + writer->in_fill, data, copy);
+        writer->in_fill += copy;
+        data += copy;
+        len -= copy;
+        if (writer->in_fill == writer->in_size) {
+            prompt_pcm_writer_encode(writer);
+        }
+    }
+}
+
+static void prompt_pcm_writer_flush(prompt_pcm_writer_t* writer) {
+    if (writer->enc && writer->in_fill > 0 && writer->ok) {
+        // 最后一帧补静音
+        memset(writer->in + writer->in_fill, 0, writer->in_size - writer->in_fill);
+        prompt_pcm_writer_encode(writer);
+    }
+}
+
+static esp_err_t prompt_pcm_writer_open(prompt_pcm_writer_t* writer, const char* path) {
+    memset(writer, 0, sizeof(prompt_pcm_writer_t));
+    writer->fp = fopen(path, "wb");
+    if (writer->fp == NULL) {
+        return ESP_FAIL;
+    }
+    writer->ok = true;
+    // 先占位文件头，写完数据后回填
+    prompt_pcm_header_t header = { 0 };
+    fwrite(&header, 1, sizeof(header), writer->fp);
+
+#if PROMPT_PCM_USE_ADPCM
+    esp_adpcm_enc_config_t cfg = {
+        .sample_rate = PROMPT_PCM_SAMPLE_RATE,
+        .channel = ESP_AUDIO_MONO,
+        .bits_per_sample = ESP_AUDIO_BIT16,
+    };
+    if (esp_adpcm_enc_open(&cfg, sizeof(cfg), &writer->enc) != ESP_AUDIO_ERR_OK) {
+        writer->enc = NULL;
+        return ESP_FAIL;
+    }
+    esp_adpcm_enc_get_frame_size(writer->enc, &writer->in_size, &writer->out_size);
+    writer->in = qmsd_malloc(writer->in_size);
+    writer->out = qmsd_malloc(writer->out_size);
+    if (writer->in == NULL || writer->out == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+#endif
+    return ESP_OK;
+}
+
+static esp_err_t prompt_pcm_writer_close(prompt_pcm_writer_t* writer) {
+    if (writer->fp && writer->ok) {
+        prompt_pcm_header_t header = {
+            .magic = PROMPT_PCM_MAGIC,
+            .format = writer->enc ? PROMPT_PCM_FORMAT_ADPCM : PROMPT_PCM_FORMAT_PCM,
+            .channel = ESP_AUDIO_MONO,
+            .block_size = writer->block_size,
+            .sample_rate = PROMPT_PCM_SAMPLE_RATE,
+            .data_size = writer->data_size,
+        };
+        fseek(writer->fp, 0, SEEK_SET);
+        writer->ok = fwrite(&header, 1, sizeof(header), writer->fp) == sizeof(header);
+    }
+    if (writer->fp) {
+        fclose(writer->fp);
+    }
+    if (writer->enc) {
+        esp_adpcm_enc_close(writer->enc);
+    }
+    qmsd_free(writer->in);
+    qmsd_free(writer->out);
+    return writer->ok && writer->data_size > 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t prompt_pcm_transcode(const char* mp3_path, const char* out_path) {
+    struct stat file_stat;
+    if (stat(mp3_path, &file_stat) != 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (file_stat.st_size > PROMPT_PCM_MP3_MAX_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    esp_err_t err = ESP_FAIL;
+    void* dec = NULL;
+    uint8_t* mp3 = qmsd_malloc(file_stat.st_size);
+    uint8_t* pcm = qmsd_malloc(PROMPT_PCM_DECODE_SIZE);
+    char temp_path[PROMPT_PCM_PATH_SIZE];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", out_path);
+    prompt_pcm_writer_t writer = { 0 };
+
+    FILE* fp = fopen(mp3_path, "rb");
+    if (fp == NULL || mp3 == NULL || pcm == NULL || fread(mp3, 1, file_stat.st_size, fp) != file_stat.st_size) {
+        goto exit;
+    }
+    if (esp_mp3_dec_open(NULL, 0, &dec) != ESP_AUDIO_ERR_OK || prompt_pcm_writer_open(&writer, temp_path) != ESP_OK) {
+        goto exit;
+    }
+
+    uint32_t offset = prompt_pcm_skip_id3(mp3, file_stat.st_size);
+    esp_audio_dec_in_raw_t raw = { .buffer = mp3 + offset, .len = file_stat.st_size - offset };
+    esp_audio_dec_info_t info = { 0 };
+    err = ESP_OK;
+    while (raw.len > 0 && writer.ok) {
+        esp_audio_dec_out_frame_t frame = { .buffer = pcm, .len = PROMPT_PCM_DECODE_SIZE };
+        if (esp_mp3_dec_decode(dec, &raw, &frame, &info) != ESP_AUDIO_ERR_OK || raw.consumed == 0) {
+            break;
+        }
+        raw.buffer += raw.consumed;
+        raw.len -= raw.consumed;
+        if (frame.decoded_size == 0) {
+            continue;
+        }
+        if (info.sample_rate != PROMPT_PCM_SAMPLE_RATE || info.channel != ESP_AUDIO_MONO || info.bits_per_sample != ESP_AUDIO_BIT16) {
+            ESP_LOGW(TAG, "%s: %lu Hz %d ch, not match speaker, skip", mp3_path, info.sample_rate, info.channel);
+            err = ESP_ERR_NOT_SUPPORTED;
+            break;
+        }
+        prompt_pcm_writer_write(&writer, pcm, frame.decoded_size);
+    }
+    if (err == ESP_OK) {
+        prompt_pcm_writer_flush(&writer);
+    }
+
+exit:
+    if (writer.fp) {
+        esp_err_t close_err = prompt_pcm_writer_close(&writer);
+        err = err == ESP_OK ? close_err : err;
+    }
+    if (err == ESP_OK && rename(temp_path, out_path) != 0) {
+        err = ESP_FAIL;
+    }
+    if (err != ESP_OK) {
+        remove(temp_path);
+    }
+    if (dec) {
+        esp_mp3_dec_close(dec);
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    qmsd_free(mp3);
+    qmsd_free(pcm);
+    ESP_LOGI(TAG, "transcode %s -> %s: %s, size: %lu", mp3_path, out_path, esp_err_to_name(err), writer.data_size);
+    return err;
+}
+
+// 没有写入回调时直接写入音频硬件
+static bool prompt_pcm_write(prompt_pcm_write_cb_t write_cb, char* data, uint32_t len, void* ctx) {
+    if (write_cb) {
+        return write_cb(data, len, ctx);
+    }
+    audio_hardware_data_write(data, len);
+    return true;
+}
+
+esp_err_t prompt_pcm_play(const char* path, prompt_pcm_write_cb_t write_cb, void* ctx) {
+    prompt_pcm_header_t header;
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (fread(&header, 1, sizeof(header), fp) != sizeof(header) || header.magic != PROMPT_PCM_MAGIC ||
+        header.sample_rate != PROMPT_PCM_SAMPLE_RATE || header.channel != ESP_AUDIO_MONO ||
+        (header.format == PROMPT_PCM_FORMAT_ADPCM && header.block_size == 0)) {
+        ESP_LOGE(TAG, "invalid file: %s", path);
+        fclose(fp);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    void* dec = NULL;
+    uint32_t in_size = header.format == PROMPT_PCM_FORMAT_ADPCM ? header.block_size : PROMPT_PCM_WRITE_SIZE;
+    // IMA-ADPCM 一个字节解出两个 16bit 采样
+    uint32_t out_size = in_size * 4;
+    uint8_t* in = qmsd_malloc(in_size);
+    uint8_t* out = header.format == PROMPT_PCM_FORMAT_ADPCM ? qmsd_malloc(out_size) : NULL;
+    esp_err_t err = in ? ESP_OK : ESP_ERR_NO_MEM;
+    if (err == ESP_OK && header.format == PROMPT_PCM_FORMAT_ADPCM) {
+        esp_adpcm_dec_cfg_t cfg = {
+            .sample_rate = header.sample_rate,
+            .channel = header.channel,
+            .bits_per_sample = 4,
+        };
+        if (out == NULL || esp_adpcm_dec_open(&cfg, sizeof(cfg), &dec) != ESP_AUDIO_ERR_OK) {
+            err = ESP_FAIL;
+        }
+    }
+
+    uint32_t remain = header.data_size;
+    while (err == ESP_OK && remain > 0) {
+        uint32_t len = fread(in, 1, remain < in_size ? remain : in_size, fp);
+        if (len == 0) {
+            break;
+        }
+        remain -= len;
+        if (dec == NULL) {
+            if (prompt_pcm_write(write_cb, (char*)in, len, ctx) == false) {
+                break;
+            }
+            continue;
+        }
+
+        esp_audio_dec_in_raw_t raw = { .buffer = in, .len = len };
+        esp_audio_dec_out_frame_t frame = { .buffer = out, .len = out_size };
+        esp_audio_dec_info_t info;
+        if (esp_adpcm_dec_decode(dec, &raw, &frame, &info) != ESP_AUDIO_ERR_OK) {
+            err = ESP_FAIL;
+            break;
+        }
+        if (prompt_pcm_write(write_cb, (char*)out, frame.decoded_size, ctx) == false) {
+            break;
+        }
+    }
+
+    if (dec) {
+        esp_adpcm_dec_close(dec);
+    }
+    qmsd_free(in);
+    qmsd_free(out);
+    fclose(fp);
+    return err;
+}
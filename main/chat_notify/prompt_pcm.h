@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 预解码提示音格式标识 "QPCM" */
+#define PROMPT_PCM_MAGIC 0x4d435051
+/** @brief 扬声器输出采样率，提示音和 TTS 均为 16k 单声道，采样率不一致的音频不转码 */
+#define PROMPT_PCM_SAMPLE_RATE 16000
+/** @brief 1: 转码为 IMA-ADPCM(约为 PCM 的 1/4 大小)，0: 转码为 16bit PCM(播放时直接拷贝) */
+#define PROMPT_PCM_USE_ADPCM 1
+/** @brief 参与转码的 mp3 文件最大长度 */
+#define PROMPT_PCM_MP3_MAX_SIZE (24 * 1024)
+
+typedef enum {
+    PROMPT_PCM_FORMAT_PCM = 0,    // 16bit PCM
+    PROMPT_PCM_FORMAT_ADPCM = 1,  // 4bit IMA-ADPCM
+} prompt_pcm_format_t;
+
+/**
+ * @brief 预解码提示音文件头，后面紧跟 data_size 字节音频数据
+ */
+typedef struct {
+    uint32_t magic;        // PROMPT_PCM_MAGIC
+    uint8_t format;        // prompt_pcm_format_t
+    uint8_t channel;       // 声道数
+    uint16_t block_size;   // ADPCM 每块字节数，PCM 为 0
+    uint32_t sample_rate;  // 采样率
+    uint32_t data_size;    // 音频数据长度
+} prompt_pcm_header_t;
+
+/**
+ * @brief 写入一块解码后的 PCM 数据
+ * @param data PCM 数据
+ * @param len 数据长度
+ * @param ctx prompt_pcm_play 传入的参数
+ * @return true 继续播放，false 中止(本块没有写入)
+ */
+typedef bool (*prompt_pcm_write_cb_t)(char* data, uint32_t len, void* ctx);
+
+/**
+ * @brief 把 mp3 提示音转码为预解码格式
+ * @param mp3_path mp3 文件路径
+ * @param out_path 输出文件路径，先写临时文件再 rename
+ * @return ESP_OK 成功，ESP_ERR_NOT_SUPPORTED 采样率或声道与扬声器不一致，其他值表示失败
+ * @note 解码和编码都比较耗时，只在后台同步任务中调用
+ */
+esp_err_t prompt_pcm_transcode(const char* mp3_path, const char* out_path);
+
+/**
+ * @brief 播放预解码提示音
+ * @param path 文件路径
+ * @param write_cb 写入每块数据，返回 false 时中止；为 NULL 时直接写入 audio_hardware_data_write
+ * @param ctx write_cb 的参数
+ * @return ESP_OK 成功，其他值表示失败
+ * @note 不经过 mp3 解码管道。由调用方写入时，调用方可以在写入前后标记，保证中止返回后不会再有数据写入硬件
+ */
+esp_err_t prompt_pcm_play(const char* path, prompt_pcm_write_cb_t write_cb, void* ctx);
@@ -0,0 +1,419 @@
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "cJSON.h"
+#include "esp_littlefs.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+
+#include "chat_notify.h"
+#include "chat_notify_manifest.h"
+#include "http_pool.h"
+#include "qmsd_utils.h"
+#include "res_pack.h"
+
+#define TAG "res_pack"
+
+#define RES_PACK_MAGIC 0x4b415052  // "RPAK"
+#define RES_PACK_FORMAT_VERSION 1
+#define RES_PACK_TEMP_PATH "/littlefs/res.tmp"
+#define RES_PACK_TEMP_SUFFIX ".new"
+#define RES_PACK_PATH_SIZE (sizeof(NOTIFY_AUDIO_PATH) + RES_PACK_NAME_SIZE + sizeof(RES_PACK_TEMP_SUFFIX))
+#define RES_PACK_URL_SIZE 512
+#define RES_PACK_BUFFER_SIZE 2048
+#define RES_PACK_PARTITION "res"
+// 下载前预留的空闲空间，LittleFS 的元数据和写时复制需要额外的块
+#define RES_PACK_SPACE_RESERVE (16 * 1024)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t pack_version;
+} res_pack_header_t;
+
+typedef struct {
+    char name[RES_PACK_NAME_SIZE];  // /littlefs 下的文件名
+    uint32_t size;
+    uint32_t crc;                   // 文件内容 crc32
+} res_pack_entry_t;
+
+typedef struct {
+    uint32_t pack_version;
+    uint16_t count;
+    res_pack_entry_t entries[RES_PACK_FILE_MAX];
+} res_pack_t;
+
+static uint32_t local_pack_version = 0;
+
+static bool res_pack_load(const char* path, res_pack_t* pack) {
+    memset(pack, 0, sizeof(res_pack_t));
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    res_pack_header_t header;
+    bool ok = fread(&header, 1, sizeof(header), fp) == sizeof(header);
+    ok = ok && header.magic == RES_PACK_MAGIC && header.version == RES_PACK_FORMAT_VERSION && header.count <= RES_PACK_FILE_MAX;
+    ok = ok && fread(pack->entries, sizeof(res_pack_entry_t), header.count, fp) == header.count;
+    fclose(fp);
+    if (ok == false) {
+        ESP_LOGW(TAG, "%s invalid", path);
+        memset(pack, 0, sizeof(res_pack_t));
+        return false;
+    }
+    pack->pack_version = header.pack_version;
+    pack->count = header.count;
+    for (int i = 0; i < pack->count; i++) {
+        pack->entries[i].name[RES_PACK_NAME_SIZE - 1] = '\0';
+    }
+    return true;
+}
+
+// 先写临时文件再 rename，目标文件要么是旧内容要么是完整的新内容
+static esp_err_t res_pack_save(const char* path, const res_pack_t* pack) {
+    res_pack_header_t header = {
+        .magic = RES_PACK_MAGIC,
+        .version = RES_PACK_FORMAT_VERSION,
+        .count = pack->count,
+        .pack_version = pack->pack_version,
+    };
+    FILE* fp = fopen(RES_PACK_TEMP_PATH, "wb");
+    if (fp == NULL) {
+        return ESP_FAIL;
+    }
+    bool ok = fwrite(&header, 1, sizeof(header), fp) == sizeof(header);
+    ok = ok && fwrite(pack->entries, sizeof(res_pack_entry_t), pack->count, fp) == pack->count;
+    fclose(fp);
+    if (ok == false || rename(RES_PACK_TEMP_PATH, path) != 0) {
+        ESP_LOGE(TAG, "save %s failed", path);
+        remove(RES_PACK_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static const res_pack_entry_t* res_pack_find(const res_pack_t* pack, const char* name) {
+    for (int i = 0; i < pack->count; i++) {
+        if (strcmp(pack->entries[i].name, name) == 0) {
+            return &pack->entries[i];
+        }
+    }
+    return NULL;
+}
+
+static bool res_pack_file_match(const char* path, uint32_t size, uint32_t crc, char* buffer) {
+    struct stat file_stat;
+    if (stat(path, &file_stat) != 0 || file_stat.st_size != size) {
+        return false;
+    }
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return false;
+    }
+    uint32_t file_crc = 0;
+    size_t len;
+    while ((len = fread(buffer, 1, RES_PACK_BUFFER_SIZE, fp)) > 0) {
+        file_crc = esp_rom_crc32_le(file_crc, (uint8_t*)buffer, len);
+    }
+    fclose(fp);
+    return file_crc == crc;
+}
+
+// 随固件打包的提示音(hashcode 为 0)被替换后，更新 chat_notify 清单中的记录
+static void res_pack_notify_refresh(const char* name, const char* path) {
+    for (int i = 0; i < MAX_NOTIFY_TYPE; i++) {
+        chat_notify_asset_t asset;
+        if (chat_notify_manifest_get(i, &asset) && asset.hashcode == 0 && strcmp(asset.name, name) == 0) {
+            chat_notify_manifest_set(i, 0, path);
+        }
+    }
+}
+
+// 按新清单替换文件，可以重复执行
+static void res_pack_apply(const res_pack_t* pack, const res_pack_t* old) {
+    char path[RES_PACK_PATH_SIZE];
+    char temp_path[RES_PACK_PATH_SIZE];
+    struct stat file_stat;
+    for (int i = 0; i < pack->count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", NOTIFY_AUDIO_PATH, pack->entries[i].name);
+        snprintf(temp_path, sizeof(temp_path), "%s%s", path, RES_PACK_TEMP_SUFFIX);
+        if (stat(temp_path, &file_stat) != 0) {
+            continue;
+        }
+        if (rename(temp_path, path) != 0) {
+            ESP_LOGE(TAG, "replace %s failed", path);
+            continue;
+        }
+        res_pack_notify_refresh(pack->entries[i].name, path);
+        ESP_LOGI(TAG, "update %s, size: %lu", pack->entries[i].name, pack->entries[i].size);
+    }
+    for (int i = 0; i < old->count; i++) {
+        if (res_pack_find(pack, old->entries[i].name) == NULL) {
+            snprintf(path, sizeof(path), "%s/%s", NOTIFY_AUDIO_PATH, old->entries[i].name);
+            remove(path);
+            ESP_LOGI(TAG, "remove %s", old->entries[i].name);
+        }
+    }
+    rename(RES_PACK_PENDING_PATH, RES_PACK_INDEX_PATH);
+    local_pack_version = pack->pack_version;
+    ESP_LOGI(TAG, "resource pack version: %lu", pack->pack_version);
+}
+
+void res_pack_init(void) {
+    res_pack_t* pack = qmsd_malloc(sizeof(res_pack_t));
+    res_pack_t* old = qmsd_malloc(sizeof(res_pack_t));
+    if (pack == NULL || old == NULL) {
+        goto init_end;
+    }
+    res_pack_load(RES_PACK_INDEX_PATH, old);
+    local_pack_version = old->pack_version;
+    if (res_pack_load(RES_PACK_PENDING_PATH, pack)) {
+        ESP_LOGW(TAG, "finish pending update %lu -> %lu", old->pack_version, pack->pack_version);
+        res_pack_apply(pack, old);
+    }
+    remove(RES_PACK_PENDING_PATH);
+
+init_end:
+    qmsd_free(pack);
+    qmsd_free(old);
+}
+
+uint32_t res_pack_get_version(void) {
+    return local_pack_version;
+}
+
+static esp_err_t res_pack_download(const char* url, const char* path, const res_pack_entry_t* entry, char* buffer) {
+    esp_http_client_handle_t client = http_pool_acquire(url, 3000);
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+    if (http_pool_open(client, NULL) != ESP_OK) {
+        http_pool_release(client, false);
+        return ESP_FAIL;
+    }
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        http_pool_release(client, false);
+        return ESP_FAIL;
+    }
+
+    uint32_t size = 0;
+    uint32_t crc = 0;
+    bool complete = false;
+    for (;;) {
+        int len = esp_http_client_read(client, buffer, RES_PACK_BUFFER_SIZE);
+        if (len < 0 || size + len > entry->size) {
+            break;
+        }
+        if (len == 0) {
+            complete = esp_http_client_is_complete_data_received(client);
+            break;
+        }
+        if (fwrite(buffer, 1, len, fp) != (size_t)len) {
+            ESP_LOGE(TAG, "write %s failed", path);
+            break;
+        }
+        crc = esp_rom_crc32_le(crc, (uint8_t*)buffer, len);
+        size += len;
+    }
+    fclose(fp);
+    http_pool_release(client, complete);
+    if (complete == false || size != entry->size || crc != entry->crc) {
+        ESP_LOGE(TAG, "download %s failed, size: %lu / %lu", entry->name, size, entry->size);
+        remove(path);
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+static char* res_pack_fetch_manifest(uint32_t version) {
+    char* url = qmsd_malloc(RES_PACK_URL_SIZE);
+    char* json = qmsd_malloc(RES_PACK_MANIFEST_MAX + 1);
+    esp_http_client_handle_t client = NULL;
+    bool complete = false;
+    if (url == NULL || json == NULL) {
+        goto fetch_end;
+    }
+    snprintf(url, RES_PACK_URL_SIZE, "%s%cversion=%s&pack=%lu", RES_PACK_MANIFEST_URL, strchr(RES_PACK_MANIFEST_URL, '?') ? '&' : '?',
+             SOFT_VERSION, version);
+    client = http_pool_acquire(url, 3000);
+    if (client == NULL || http_pool_open(client, NULL) != ESP_OK) {
+        goto fetch_end;
+    }
+    int total = 0;
+    for (;;) {
+        int len = esp_http_client_read(client, json + total, RES_PACK_MANIFEST_MAX - total);
+        if (len < 0) {
+            break;
+        }
+        total += len;
+        if (len == 0 || total == RES_PACK_MANIFEST_MAX) {
+            complete = esp_http_client_is_complete_data_received(client);
+            break;
+        }
+    }
+    json[total] = '\0';
+
+fetch_end:
+    if (client) {
+        http_pool_release(client, complete);
+    }
+    qmsd_free(url);
+    if (complete == false) {
+        ESP_LOGE(TAG, "fetch manifest failed");
+        qmsd_free(json);
+        return NULL;
+    }
+    return json;
+}
+
+// 文件名不能带目录，带 @ 的文件属于 chat_notify 的音色同步，也不能与清单和临时文件冲突
+static bool res_pack_name_valid(const char* name) {
+    static const char* const reserved_ext[] = { RES_PACK_TEMP_SUFFIX, ".idx", ".pnd", ".tmp", ".part" };
+    if (name == NULL || name[0] == '\0' || strlen(name) >= RES_PACK_NAME_SIZE || strpbrk(name, "/@")) {
+        return false;
+    }
+    const char* ext = strrchr(name, '.');
+    for (int i = 0; ext && i < sizeof(reserved_ext) / sizeof(reserved_ext[0]); i++) {
+        if (strcmp(ext, reserved_ext[i]) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// 解析服务器清单到 pack，need 按位标记需要下载的文件
+static esp_err_t res_pack_parse(cJSON* files, const res_pack_t* local, res_pack_t* pack, uint64_t* need, uint32_t* need_size,
+                                char* buffer) {
+    char path[RES_PACK_PATH_SIZE];
+    cJSON* file;
+    *need = 0;
+    *need_size = 0;
+    pack->count = 0;
+    cJSON_ArrayForEach(file, files) {
+        const char* name = cJSON_GetStringValue(cJSON_GetObjectItem(file, "name"));
+        cJSON* size = cJSON_GetObjectItem(file, "size");
+        cJSON* crc = cJSON_GetObjectItem(file, "crc32");
+        if (pack->count >= RES_PACK_FILE_MAX || res_pack_name_valid(name) == false || cJSON_IsNumber(size) == false ||
+            cJSON_IsNumber(crc) == false) {
+            ESP_LOGE(TAG, "invalid file entry: %s", name ? name : "null");
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        res_pack_entry_t* entry = &pack->entries[pack->count];
+        strcpy(entry->name, name);
+        entry->size = (uint32_t)cJSON_GetNumberValue(size);
+        entry->crc = (uint32_t)cJSON_GetNumberValue(crc);
+
+        // 本地清单中记录过的文件只比较清单，没有记录的文件(如随固件烧录的资源)第一次按内容比较
+        const res_pack_entry_t* old = res_pack_find(local, name);
+        snprintf(path, sizeof(path), "%s/%s", NOTIFY_AUDIO_PATH, name);
+        struct stat file_stat;
+        bool same = false;
+        if (old) {
+            same = old->size == entry->size && old->crc == entry->crc && stat(path, &file_stat) == 0 && file_stat.st_size == entry->size;
+        } else {
+            same = res_pack_file_match(path, entry->size, entry->crc, buffer);
+        }
+        if (same == false) {
+            *need |= 1ULL << pack->count;
+            *need_size += entry->size;
+        }
+        pack->count += 1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t res_pack_update(void) {
+    if (strlen(RES_PACK_MANIFEST_URL) == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_err_t err = ESP_ERR_NO_MEM;
+    res_pack_t* local = qmsd_malloc(sizeof(res_pack_t));
+    res_pack_t* pack = qmsd_malloc(sizeof(res_pack_t));
+    char* buffer = qmsd_malloc(RES_PACK_BUFFER_SIZE);
+    char* url = qmsd_malloc(RES_PACK_URL_SIZE);
+    char* json = NULL;
+    cJSON* root = NULL;
+    if (local == NULL || pack == NULL || buffer == NULL || url == NULL) {
+        goto update_end;
+    }
+    res_pack_load(RES_PACK_INDEX_PATH, local);
+
+    err = ESP_FAIL;
+    json = res_pack_fetch_manifest(local->pack_version);
+    root = json ? cJSON_Parse(json) : NULL;
+    if (root == NULL) {
+        goto update_end;
+    }
+    cJSON* version = cJSON_GetObjectItem(root, "version");
+    cJSON* files = cJSON_GetObjectItem(root, "files");
+    const char* base = cJSON_GetStringValue(cJSON_GetObjectItem(root, "base"));
+    if (cJSON_IsNumber(version) == false || cJSON_IsArray(files) == false) {
+        err = ESP_ERR_INVALID_RESPONSE;
+        goto update_end;
+    }
+    pack->pack_version = (uint32_t)cJSON_GetNumberValue(version);
+    if (pack->pack_version == local->pack_version) {
+        ESP_LOGI(TAG, "resource pack %lu is up to date", local->pack_version);
+        err = ESP_OK;
+        goto update_end;
+    }
+
+    uint64_t need = 0;
+    uint32_t need_size = 0;
+    err = res_pack_parse(files, local, pack, &need, &need_size, buffer);
+    if (err != ESP_OK) {
+        goto update_end;
+    }
+    size_t total = 0;
+    size_t used = 0;
+    if (esp_littlefs_info(RES_PACK_PARTITION, &total, &used) != ESP_OK || used + need_size + RES_PACK_SPACE_RESERVE > total) {
+        ESP_LOGE(TAG, "no space for %lu bytes, used: %d / %d", need_size, used, total);
+        err = ESP_ERR_NO_MEM;
+        goto update_end;
+    }
+    ESP_LOGI(TAG, "update %lu -> %lu, download %lu bytes", local->pack_version, pack->pack_version, need_size);
+
+    // 逐个下载到临时文件，已经完整下载过的临时文件直接复用
+    char temp_path[RES_PACK_PATH_SIZE];
+    for (int i = 0; i < pack->count && err == ESP_OK; i++) {
+        if ((need & (1ULL << i)) == 0) {
+            continue;
+        }
+        res_pack_entry_t* entry = &pack->entries[i];
+        snprintf(temp_path, sizeof(temp_path), "%s/%s%s", NOTIFY_AUDIO_PATH, entry->name, RES_PACK_TEMP_SUFFIX);
+        if (res_pack_file_match(temp_path, entry->size, entry->crc, buffer)) {
+            continue;
+        }
+        const char* file_url = cJSON_GetStringValue(cJSON_GetObjectItem(cJSON_GetArrayItem(files, i), "url"));
+        if (file_url) {
+            snprintf(url, RES_PACK_URL_SIZE, "%s", file_url);
+        } else if (base) {
+            snprintf(url, RES_PACK_URL_SIZE, "%s%s", base, entry->name);
+        } else {
+            err = ESP_ERR_INVALID_RESPONSE;
+            break;
+        }
+        err = res_pack_download(url, temp_path, entry, buffer);
+    }
+
+    // 新清单写入即提交，之后的替换中断时在下次启动完成
+    if (err == ESP_OK) {
+        err = res_pack_save(RES_PACK_PENDING_PATH, pack);
+    }
+    if (err == ESP_OK) {
+        res_pack_apply(pack, local);
+    }
+
+update_end:
+    cJSON_Delete(root);
+    qmsd_free(json);
+    qmsd_free(url);
+    qmsd_free(buffer);
+    qmsd_free(pack);
+    qmsd_free(local);
+    return err;
+}
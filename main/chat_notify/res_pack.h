@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 资源包清单地址，为空时不检查更新；可以在编译时用 -DRES_PACK_MANIFEST_URL=\"...\" 指定 */
+#ifndef RES_PACK_MANIFEST_URL
+#define RES_PACK_MANIFEST_URL ""
+#endif
+
+/** @brief 本地资源包清单 */
+#define RES_PACK_INDEX_PATH "/littlefs/res.idx"
+/** @brief 已下载完、等待替换的新清单，存在即表示已提交 */
+#define RES_PACK_PENDING_PATH "/littlefs/res.pnd"
+/** @brief 资源包中的文件数量上限 */
+#define RES_PACK_FILE_MAX 64
+/** @brief 文件名最大长度，与 chat_notify_asset_t.name 一致 */
+#define RES_PACK_NAME_SIZE 48
+/** @brief 服务器清单的最大长度 */
+#define RES_PACK_MANIFEST_MAX (8 * 1024)
+
+/**
+ * @brief 完成上次未完成的资源包替换
+ * @note 需要在挂载 LittleFS 之后、读取任何资源文件之前调用。新清单存在时按新清单把临时文件
+ *       重命名为正式文件并删除已移除的文件，替换过程可重入，中途掉电下次启动继续
+ */
+void res_pack_init(void);
+
+/**
+ * @brief 检查并下载资源包更新
+ * @return ESP_OK 已是最新或更新完成，ESP_ERR_NOT_SUPPORTED 没有配置清单地址，其他值表示失败
+ * @note 服务器清单为 JSON:
+ *       {"version": 3, "base": "https://.../", "files": [{"name": "xx.mp3", "size": 1234, "crc32": 5678, "url": "..."}]}
+ *       url 省略时为 base + name。只下载大小或 crc32 与本地不同的文件，先写入 <name>.new 并校验，
+ *       全部下载完成后写入新清单(提交点)再逐个替换。只管理清单中列出的文件，
+ *       带 @hashcode 的音色文件仍由 chat_notify 同步，不受资源包影响
+ */
+esp_err_t res_pack_update(void);
+
+/**
+ * @brief 获取本地资源包版本
+ * @return 版本号，没有清单时为 0
+ */
+uint32_t res_pack_get_version(void);
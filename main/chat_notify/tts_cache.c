@@ -0,0 +1,324 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "aiha_audio_http.h"
+#include "aiha_websocket.h"
+#include "audio_player_user.h"
+#include "chat_player.h"
+#include "qmsd_utils.h"
+#include "tts_cache.h"
+
+#define TAG "tts_cache"
+
+#define TTS_CACHE_INDEX_PATH TTS_CACHE_DIR "/index.bin"
+#define TTS_CACHE_INDEX_TEMP_PATH TTS_CACHE_DIR "/index.tmp"
+#define TTS_CACHE_MAGIC 0x43535454  // "TTSC"
+#define TTS_CACHE_VERSION 2
+#define TTS_CACHE_TEXT_SIZE 256
+
+#define TTS_CACHE_PATH_COVER(key, file_path)                                             \
+    do {                                                                                 \
+        snprintf(file_path, TTS_CACHE_PATH_SIZE, "%s/%08lx.mp3", TTS_CACHE_DIR, key);   \
+    } while (0)
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t access_seq;
+} tts_cache_header_t;
+
+typedef struct {
+    uint32_t key;     // hash(文本, 音色)，同时是文件名
+    uint32_t check;   // 另一种 hash(文本, 音色)，key 冲突时区分不同文本
+    uint32_t size;    // 文件大小
+    uint32_t access;  // 最近一次访问的序号，越小越久未使用
+} tts_cache_entry_t;
+
+static tts_cache_header_t cache_header;
+static tts_cache_entry_t cache_entries[TTS_CACHE_ENTRY_MAX];
+static uint32_t cache_total_size = 0;
+static SemaphoreHandle_t cache_lock;
+// 未命中后等待 TTS 地址的请求，回调不带文本，只有一个请求在等待时才能确定地址对应的文本
+static char pending_text[TTS_CACHE_TEXT_SIZE];
+static uint32_t pending_key = 0;      // 0 表示没有请求在等待，或者有多个请求无法区分
+static TickType_t pending_ticks = 0;  // 最近一次请求的时间，超时后清空
+static uint32_t tee_key = 0;
+
+// FNV-1a，音色 hashcode 参与计算，换音色后自然不命中
+static uint32_t tts_cache_key(const char* text, int hashcode) {
+    uint32_t hash = 2166136261u;
+    for (const uint8_t* p = (const uint8_t*)text; *p; p++) {
+        hash = (hash ^ *p) * 16777619u;
+    }
+    for (int i = 0; i < (int)sizeof(hashcode); i++) {
+        hash = (hash ^ ((hashcode >> (i * 8)) & 0xff)) * 16777619u;
+    }
+    return hash;
+}
+
+// djb2，与 key 独立，两者同时冲突的概率可以忽略
+static uint32_t tts_cache_check(const char* text, int hashcode) {
+    uint32_t hash = 5381;
+    for (const uint8_t* p = (const uint8_t*)text; *p; p++) {
+        hash = hash * 33 + *p;
+    }
+    return hash * 33 + (uint32_t)hashcode;
+}
+
+static int tts_cache_find(uint32_t key) {
+    for (int i = 0; i < cache_header.count; i++) {
+        if (cache_entries[i].key == key) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 先写临时文件再 rename，掉电时索引要么是旧的要么是新的
+static esp_err_t tts_cache_index_save(void) {
+    FILE* fp = fopen(TTS_CACHE_INDEX_TEMP_PATH, "wb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "open %s failed", TTS_CACHE_INDEX_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    size_t entries_size = cache_header.count * sizeof(tts_cache_entry_t);
+    bool ok = fwrite(&cache_header, 1, sizeof(cache_header), fp) == sizeof(cache_header);
+    ok = ok && fwrite(cache_entries, 1, entries_size, fp) == entries_size;
+    fclose(fp);
+    if (ok == false || rename(TTS_CACHE_INDEX_TEMP_PATH, TTS_CACHE_INDEX_PATH) != 0) {
+        ESP_LOGE(TAG, "save index failed");
+        remove(TTS_CACHE_INDEX_TEMP_PATH);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// 删除不在索引中的文件: 加入缓存时先 rename 再保存索引，中途掉电或者索引失效会留下这些文件
+static void tts_cache_clean(void) {
+    DIR* dir = opendir(TTS_CACHE_DIR);
+    if (dir == NULL) {
+        return;
+    }
+    char path[TTS_CACHE_PATH_SIZE + 16];
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        uint32_t key = 0;
+        char tail[8] = { 0 };
+        if (strcmp(entry->d_name, "index.bin") == 0) {
+            continue;
+        }
+        if (sscanf(entry->d_name, "%08lx%7s", &key, tail) == 2 && strcmp(tail, ".mp3") == 0 && tts_cache_find(key) >= 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", TTS_CACHE_DIR, entry->d_name);
+        ESP_LOGW(TAG, "remove orphan %s", path);
+        remove(path);
+    }
+    closedir(dir);
+}
+
+static void tts_cache_index_load(void) {
+    memset(&cache_header, 0, sizeof(cache_header));
+    cache_total_size = 0;
+
+    FILE* fp = fopen(TTS_CACHE_INDEX_PATH, "rb");
+    if (fp != NULL) {
+        bool ok = fread(&cache_header, 1, sizeof(cache_header), fp) == sizeof(cache_header);
+        ok = ok && cache_header.magic == TTS_CACHE_MAGIC && cache_header.version == TTS_CACHE_VERSION;
+        ok = ok && cache_header.count <= TTS_CACHE_ENTRY_MAX;
+        size_t entries_size = ok ? cache_header.count * sizeof(tts_cache_entry_t) : 0;
+        ok = ok && fread(cache_entries, 1, entries_size, fp) == entries_size;
+        fclose(fp);
+        if (ok == false) {
+            ESP_LOGW(TAG, "index invalid, reset");
+            memset(&cache_header, 0, sizeof(cache_header));
+        }
+    }
+
+    cache_header.magic = TTS_CACHE_MAGIC;
+    cache_header.version = TTS_CACHE_VERSION;
+    for (int i = 0; i < cache_header.count; i++) {
+        cache_total_size += cache_entries[i].size;
+    }
+    tts_cache_clean();
+    ESP_LOGI(TAG, "cache entries: %d, size: %lu", cache_header.count, cache_total_size);
+}
+
+// 淘汰最久未使用的条目，直到能放下 size 字节的新文件
+static void tts_cache_evict(uint32_t size, uint32_t* evict_keys, uint8_t* evict_num) {
+    *evict_num = 0;
+    while (cache_header.count > 0 && (cache_total_size + size > TTS_CACHE_BUDGET || cache_header.count >= TTS_CACHE_ENTRY_MAX)) {
+        int oldest = 0;
+        for (int i = 1; i < cache_header.count; i++) {
+            if (cache_entries[i].access < cache_entries[oldest].access) {
+                oldest = i;
+            }
+        }
+        evict_keys[(*evict_num)++] = cache_entries[oldest].key;
+        cache_total_size -= cache_entries[oldest].size;
+        cache_header.count -= 1;
+        cache_entries[oldest] = cache_entries[cache_header.count];
+    }
+}
+
+bool tts_cache_lookup(const char* text, char path[TTS_CACHE_PATH_SIZE]) {
+    int hashcode = aiha_websocket_get_tts_hashcode();
+    if (cache_lock == NULL || text == NULL || hashcode == 0) {
+        return false;
+    }
+    uint32_t key = tts_cache_key(text, hashcode);
+    uint32_t check = tts_cache_check(text, hashcode);
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int index = tts_cache_find(key);
+    if (index >= 0 && cache_entries[index].check != check) {
+        // key 相同但文本不同，不能播放别的回答
+        index = -1;
+    }
+    if (index >= 0) {
+        // 访问顺序只在内存中更新，随下一次写入索引时落盘，避免每次命中都写 flash
+        cache_header.access_seq += 1;
+        cache_entries[index].access = cache_header.access_seq;
+        TTS_CACHE_PATH_COVER(key, path);
+    }
+    xSemaphoreGive(cache_lock);
+    return index >= 0;
+}
+
+esp_err_t tts_cache_store(const char* text, const char* file_path) {
+    int hashcode = aiha_websocket_get_tts_hashcode();
+    struct stat file_stat;
+    if (cache_lock == NULL || text == NULL || hashcode == 0 || stat(file_path, &file_stat) != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (file_stat.st_size == 0 || file_stat.st_size > TTS_CACHE_BUDGET) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint32_t key = tts_cache_key(text, hashcode);
+    uint32_t check = tts_cache_check(text, hashcode);
+    uint32_t evict_keys[TTS_CACHE_ENTRY_MAX];
+    uint8_t evict_num = 0;
+    char cache_path[TTS_CACHE_PATH_SIZE];
+    TTS_CACHE_PATH_COVER(key, cache_path);
+
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    int index = tts_cache_find(key);
+    if (index >= 0 && cache_entries[index].check == check) {
+        xSemaphoreGive(cache_lock);
+        return ESP_OK;
+    }
+    if (index >= 0) {
+        // key 冲突的旧条目直接被新文件覆盖
+        cache_total_size -= cache_entries[index].size;
+        cache_header.count -= 1;
+        cache_entries[index] = cache_entries[cache_header.count];
+    }
+    tts_cache_evict(file_stat.st_size, evict_keys, &evict_num);
+
+    esp_err_t err = ESP_FAIL;
+    if (rename(file_path, cache_path) == 0) {
+        cache_header.access_seq += 1;
+        cache_entries[cache_header.count].key = key;
+        cache_entries[cache_header.count].check = check;
+        cache_entries[cache_header.count].size = file_stat.st_size;
+        cache_entries[cache_header.count].access = cache_header.access_seq;
+        cache_header.count += 1;
+        cache_total_size += file_stat.st_size;
+        err = ESP_OK;
+    }
+    // 先落盘索引再删除被淘汰的文件，索引中的条目总有对应文件
+    tts_cache_index_save();
+    xSemaphoreGive(cache_lock);
+
+    char evict_path[TTS_CACHE_PATH_SIZE];
+    for (int i = 0; i < evict_num; i++) {
+        TTS_CACHE_PATH_COVER(evict_keys[i], evict_path);
+        remove(evict_path);
+    }
+    ESP_LOGI(TAG, "store %s, size: %ld, evict: %d, total: %lu", cache_path, file_stat.st_size, evict_num, cache_total_size);
+    return err;
+}
+
+// 播放任务中调用，ctx 为开始播放时的缓存键，期间又有新的地址时不保存
+static void tts_cache_tee_cb(const char* path, void* ctx) {
+    char text[TTS_CACHE_TEXT_SIZE];
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    bool match = tee_key == (uint32_t)(uintptr_t)ctx;
+    strcpy(text, pending_text);
+    xSemaphoreGive(cache_lock);
+    if (match && tts_cache_key(text, aiha_websocket_get_tts_hashcode()) == (uint32_t)(uintptr_t)ctx) {
+        tts_cache_store(text, path);
+    }
+}
+
+void tts_cache_init(void) {
+    if (cache_lock) {
+        return;
+    }
+    mkdir(TTS_CACHE_DIR, 0775);
+    cache_lock = xSemaphoreCreateMutex();
+    tts_cache_index_load();
+}
+
+void tts_cache_play(const char* text) {
+    char path[TTS_CACHE_PATH_SIZE + sizeof(MP3_URL_FROM_FILE)];
+    if (text == NULL) {
+        return;
+    }
+    if (tts_cache_lookup(text, path + strlen(MP3_URL_FROM_FILE))) {
+        memcpy(path, MP3_URL_FROM_FILE, strlen(MP3_URL_FROM_FILE));
+        ESP_LOGI(TAG, "hit: %s", text);
+        chat_player_play_url(path);
+        return;
+    }
+
+    if (cache_lock) {
+        bool cacheable = strlen(text) < TTS_CACHE_TEXT_SIZE;
+        xSemaphoreTake(cache_lock, portMAX_DELAY);
+        if (pending_ticks && xTaskGetTickCount() - pending_ticks < pdMS_TO_TICKS(TTS_CACHE_PENDING_TIMEOUT_MS)) {
+            // 上一个请求还没有返回地址，两个地址无法区分，这一轮都不缓存
+            pending_key = 0;
+        } else if (cacheable) {
+            strcpy(pending_text, text);
+            pending_key = tts_cache_key(text, aiha_websocket_get_tts_hashcode());
+        } else {
+            pending_key = 0;
+        }
+        pending_ticks = xTaskGetTickCount();
+        xSemaphoreGive(cache_lock);
+    }
+    aiha_request_tts_async(text);
+}
+
+void tts_cache_play_url(const char* url) {
+    if (cache_lock == NULL) {
+        chat_player_play_url(url);
+        return;
+    }
+
+    uint32_t key = 0;
+    xSemaphoreTake(cache_lock, portMAX_DELAY);
+    if (pending_ticks && xTaskGetTickCount() - pending_ticks < pdMS_TO_TICKS(TTS_CACHE_PENDING_TIMEOUT_MS)) {
+        key = pending_key;
+    }
+    // 每个地址消费一次等待中的请求，请求失败没有地址时由超时清空
+    pending_key = 0;
+    pending_ticks = 0;
+    tee_key = key;
+    xSemaphoreGive(cache_lock);
+
+    if (key == 0) {
+        chat_player_play_url(url);
+        return;
+    }
+    chat_player_play_url_tee(url, tts_cache_tee_cb, (void*)(uintptr_t)key);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 缓存目录 */
+#define TTS_CACHE_DIR "/littlefs/ttsc"
+/** @brief 缓存占用的空间上限(字节)，超出后按最久未使用淘汰 */
+#define TTS_CACHE_BUDGET (96 * 1024)
+/** @brief 缓存条目数量上限 */
+#define TTS_CACHE_ENTRY_MAX 48
+/** @brief 缓存文件路径最大长度 */
+#define TTS_CACHE_PATH_SIZE 40
+/** @brief 未命中请求等待 TTS 地址的超时时间(ms)，超时后的地址只播放不缓存 */
+#define TTS_CACHE_PENDING_TIMEOUT_MS 8000
+
+/**
+ * @brief 初始化 TTS 缓存
+ * @note 需要在 littlefs 挂载之后调用，一次读取索引文件
+ */
+void tts_cache_init(void);
+
+/**
+ * @brief 查找文本在当前音色下的缓存文件
+ * @param text TTS 文本
+ * @param path 输出参数，命中时写入缓存文件路径(不带 file:/ 前缀)
+ * @return true 命中，false 未命中
+ * @note 缓存以 (文本, aiha_websocket_get_tts_hashcode()) 的哈希为键，命中会更新访问顺序
+ */
+bool tts_cache_lookup(const char* text, char path[TTS_CACHE_PATH_SIZE]);
+
+/**
+ * @brief 把已下载好的音频文件加入缓存
+ * @param text TTS 文本
+ * @param file_path 音频文件路径，成功后文件被移动(rename)到缓存目录
+ * @return ESP_OK 成功，其他值表示失败，失败时 file_path 保持不变
+ * @note 超出 TTS_CACHE_BUDGET 时先淘汰最久未使用的条目，索引通过临时文件 + rename 原子更新
+ */
+esp_err_t tts_cache_store(const char* text, const char* file_path);
+
+/**
+ * @brief 播放文本的 TTS 音频
+ * @param text TTS 文本
+ * @note 命中缓存时直接播放本地文件；未命中时走 aiha_request_tts_async，拿到地址后由 tts_cache_play_url 边播边存
+ */
+void tts_cache_play(const char* text);
+
+/**
+ * @brief 播放 aiha_request_tts_async 返回的 TTS 地址
+ * @param url TTS 音频地址
+ * @note 在 aiha_request_tts_set_cb 的回调中调用。只有一个未命中请求在 TTS_CACHE_PENDING_TIMEOUT_MS 内等待时
+ *       才能确定地址对应的文本，此时播放的同时写入临时文件，完整播放后加入缓存；否则只播放不缓存
+ */
+void tts_cache_play_url(const char* url);
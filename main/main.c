@@ -17,14 +17,19 @@
 #include "qmsd_utils.h"
 #include "qmsd_wifi_sta.h"
 #include "storage_nvs.h"
+#include "storage_settings.h"
 
+#include "boot_stage.h"
 #include "aiha_ai_chat.h"
 #include "aiha_http_common.h"
 #include "audio_hardware.h"
 #include "aiha_audio_http.h"
 #include "chat_asr_ctrl.h"
 #include "chat_notify.h"
+#include "chat_player.h"
+#include "http_pool.h"
 #include "gx8006.h"
+#include "tts_cache.h"
 
 #define TAG "MAIN"
 
@@ -64,6 +69,18 @@ void littlefs_init(void) {
     }
 }
 
+// 资源分区和 TTS 缓存，提示音模块依赖它
+static void boot_littlefs(void) {
+    littlefs_init();
+    tts_cache_init();
+}
+
+static void boot_gx8006(void) {
+    ESP_LOGI(TAG, "gx8006 startup wait start");
+    gx8006_wait_startup(portMAX_DELAY);
+    ESP_LOGI(TAG, "gx8006 startup wait done");
+}
+
 void btn_callback_cb(btn_handle_t handle, void* user_data) {
     if (qmsd_button_get_repeat(handle) > 3) {
         storage_nvs_erase_key("wifiCfg");
@@ -86,7 +103,7 @@ void btn_callback_cb(btn_handle_t handle, void* user_data) {
 
 void aiha_tts_cb(const char* url, void* user_data) {
     ESP_LOGI(TAG, "tts url: %s", url);
-    audio_player_play_url(url, 1);
+    tts_cache_play_url(url);
 }
 
 void app_main(void) {
@@ -105,18 +122,28 @@ void app_main(void) {
     esp_log_level_set("AUDIO_THREAD", ESP_LOG_ERROR);
     esp_log_level_set("i2s_std", ESP_LOG_DEBUG);
 
+    // 启动顺序按依赖关系并行: 语音芯片启动、资源分区挂载、Wi-Fi 连接同时进行，
+    // 提示音在音频和资源分区就绪后即可播放，对话服务在联网和语音芯片就绪后启动
+    boot_stage_init();
+    boot_stage_begin(BOOT_STAGE_NVS);
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
+    storage_nvs_init();
+    storage_settings_init();
+    boot_stage_done(BOOT_STAGE_NVS);
 
     printf("QMSD Start, version: " SOFT_VERSION "\n");
     gx8006_init(UART_NUM_1, EXT_UART_TXD_PIN, EXT_UART_RXD_PIN, EXT_UART_STA_PIN, EXT_AUDIO_RST_PIN, 921600);
     gx8006_set_audio_recv_callback(aiha_audio_recv_callback);
-    ESP_LOGI(TAG, "gx8006 startup wait start");
-    gx8006_wait_startup(portMAX_DELAY);
-    ESP_LOGI(TAG, "gx8006 startup wait done");
+    boot_stage_run(BOOT_STAGE_GX8006, boot_gx8006, 0, 2 * 1024);
+    boot_stage_run(BOOT_STAGE_LITTLEFS, boot_littlefs, 0, 4 * 1024);
+
+    aiha_http_set_production_id("C38006");
+    aiha_request_tts_set_cb(aiha_tts_cb);
+    qmsd_network_start(aiha_ai_chat_start);
 
     void led_status_init();
     led_status_init();
@@ -129,35 +156,26 @@ void app_main(void) {
     btn_config.update_task.stack = 2 * 1024;
     qmsd_button_init(&btn_config);
 
-    aiha_http_set_production_id("C38006");
-    aiha_request_tts_set_cb(aiha_tts_cb);
-
-    storage_nvs_init();
-    littlefs_init();
+    boot_stage_begin(BOOT_STAGE_AUDIO);
     audio_hardware_init();
     audio_player_init();
-    chat_notify_init();
-
+    chat_player_init();
+    vol_status = storage_settings_get(STORAGE_SETTING_VOLUME);
+    printf("vol_status: %d \n", vol_status);
+    audio_hardware_set_volume(vol_status);
+    boot_stage_done(BOOT_STAGE_AUDIO);
 
     btn = qmsd_button_create_gpio(KEY_0_PIN, 0, NULL);
     qmsd_button_register_cb(btn, BUTTON_PRESS_DOWN, btn_callback_cb);
     qmsd_button_start(btn);
 
-    uint8_t* volume_index = NULL;
-    uint32_t lenv = sizeof(uint8_t);
-    if (storage_nvs_read_blob("volume", (void**)&volume_index, &lenv) == ESP_OK) {
-        vol_status = *volume_index;
-    } else {
-        vol_status = 60;
-    }
-    printf("vol_status: %d \n", vol_status);
-
-    audio_hardware_set_volume(vol_status);
-
+    boot_stage_wait(BOOT_STAGE_BIT(BOOT_STAGE_LITTLEFS), portMAX_DELAY);
+    boot_stage_begin(BOOT_STAGE_NOTIFY);
+    chat_notify_init();
+    // 开机提示音在标记完成之前播放，保证联网成功提示音排在它之后
     chat_notify_audio_play(NOTIFY_STARTUP, NULL);
-    qmsd_network_start(aiha_ai_chat_start);
+    boot_stage_done(BOOT_STAGE_NOTIFY);
 
-    int volume_diff_count = 0;
     for (;;) {
         vTaskDelay(pdMS_TO_TICKS(40));
 
@@ -173,25 +191,20 @@ void app_main(void) {
             // 自动拼接 从"file:/" "/spiffs/wifi_failed.mp3"=>"file:/spiffs/wifi_failed.mp3"
         } else if (input == 'e') {
             ESP_LOGE(TAG, "stop");
-            audio_player_stop_speak();  // 清除mp3流
+            chat_player_stop();  // 清除mp3流
             ESP_LOGE(TAG, "stop finish");
         } else if (input == 'c') {
 
         } else if (input == 'a') {
             ESP_LOGE(TAG, "audio_player_get_remaining_size: %d", audio_player_get_remaining_size());
-        }
-
-        if (vol_status != audio_hardware_get_volume()) {
-            volume_diff_count += 1;
-        } else {
-            volume_diff_count = 0;
-        }
-
-        if (volume_diff_count > 100) {
-            vol_status = audio_hardware_get_volume();
-            storage_nvs_write_blob("volume", &vol_status, sizeof(vol_status));
-            ESP_LOGI(TAG, "write to flash new volume: %d", vol_status);
-            volume_diff_count = 0;
+        } else if (input == 'h') {
+            http_pool_stats_t stats;
+            http_pool_get_stats(&stats);
+            ESP_LOGI(TAG, "http connect tcp: %lu, tls: %lu, tls last: %lu ms, tls avg: %lu ms", stats.tcp_connect_count,
+                     stats.tls_connect_count, stats.tls_connect_last_ms,
+                     stats.tls_connect_count ? stats.tls_connect_total_ms / stats.tls_connect_count : 0);
+        } else if (input == 'b') {
+            boot_stage_print();
         }
     }
 }
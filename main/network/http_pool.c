@@ -0,0 +1,249 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "http_pool.h"
+
+#define TAG "http_pool"
+
+#define HTTP_POOL_HOST_KEY_SIZE 96
+#define HTTP_POOL_MAX_REDIRECT 3
+
+typedef struct {
+    esp_http_client_handle_t client;
+    char host_key[HTTP_POOL_HOST_KEY_SIZE];  // scheme://host:port
+    bool in_use;
+    TickType_t last_used_ticks;
+    int64_t open_start_us;  // 本次 open 的开始时间，用于统计建连耗时
+} http_pool_item_t;
+
+static http_pool_item_t pool_items[HTTP_POOL_SIZE];
+static SemaphoreHandle_t pool_lock;
+static SemaphoreHandle_t pool_available;
+static http_pool_stats_t pool_stats;
+
+extern esp_err_t esp_crt_bundle_attach(void* conf);
+
+static void http_pool_get_host_key(const char* url, char* key, uint32_t key_size) {
+    const char* host = strstr(url, "://");
+    host = host ? host + 3 : url;
+    const char* path = strchr(host, '/');
+    uint32_t len = path ? path - url : strlen(url);
+    if (len >= key_size) {
+        len = key_size - 1;
+    }
+    memcpy(key, url, len);
+    key[len] = '\0';
+}
+
+// 只有真正建立连接时才会收到 HTTP_EVENT_ON_CONNECTED，复用的连接不会触发
+static esp_err_t http_pool_event_handler(esp_http_client_event_t* evt) {
+    http_pool_item_t* item = (http_pool_item_t*)evt->user_data;
+    if (evt->event_id != HTTP_EVENT_ON_CONNECTED || item == NULL || item->open_start_us == 0) {
+        return ESP_OK;
+    }
+
+    uint32_t connect_ms = (esp_timer_get_time() - item->open_start_us) / 1000;
+    bool is_tls = strncmp(item->host_key, "https", 5) == 0;
+    if (is_tls) {
+        pool_stats.tls_connect_count += 1;
+        pool_stats.tls_connect_total_ms += connect_ms;
+        pool_stats.tls_connect_last_ms = connect_ms;
+    } else {
+        pool_stats.tcp_connect_count += 1;
+    }
+    ESP_LOGI(TAG, "%s connect %s cost %lu ms", is_tls ? "tls" : "tcp", item->host_key, connect_ms);
+    return ESP_OK;
+}
+
+static esp_http_client_handle_t http_pool_client_create(const char* url, http_pool_item_t* item) {
+    esp_http_client_config_t config = {
+        .url = url,
+        .timeout_ms = 10000,
+        .buffer_size = 2048,
+        .keep_alive_enable = true,
+        .event_handler = http_pool_event_handler,
+        .user_data = item,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+#if CONFIG_ESP_TLS_CLIENT_SESSION_TICKETS
+        // 会话票据保存在句柄中，连接断开后重连使用简化握手
+        .save_client_session = true,
+#endif
+    };
+    return esp_http_client_init(&config);
+}
+
+void http_pool_init(void) {
+    if (pool_lock) {
+        return;
+    }
+    pool_lock = xSemaphoreCreateMutex();
+    pool_available = xSemaphoreCreateCounting(HTTP_POOL_SIZE, HTTP_POOL_SIZE);
+}
+
+esp_http_client_handle_t http_pool_acquire(const char* url, uint32_t timeout_ms) {
+    if (url == NULL) {
+        return NULL;
+    }
+    http_pool_init();
+
+    if (xSemaphoreTake(pool_available, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        ESP_LOGW(TAG, "no idle client for %s", url);
+        return NULL;
+    }
+
+    char host_key[HTTP_POOL_HOST_KEY_SIZE];
+    http_pool_get_host_key(url, host_key, sizeof(host_key));
+    TickType_t now = xTaskGetTickCount();
+
+    xSemaphoreTake(pool_lock, portMAX_DELAY);
+    http_pool_item_t* item = NULL;
+    // 1. 同一主机的空闲连接
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (pool_items[i].in_use == false && pool_items[i].client && strcmp(pool_items[i].host_key, host_key) == 0) {
+            item = &pool_items[i];
+            break;
+        }
+    }
+    if (item && now - item->last_used_ticks > pdMS_TO_TICKS(HTTP_POOL_IDLE_TIMEOUT_MS)) {
+        // 只关闭连接，保留句柄和其中的TLS会话，重连时恢复会话
+        esp_http_client_close(item->client);
+    }
+    // 2. 未使用的槽位，或最久未使用的空闲连接
+    if (item == NULL) {
+        for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+            if (pool_items[i].in_use) {
+                continue;
+            }
+            if (pool_items[i].client == NULL) {
+                item = &pool_items[i];
+                break;
+            }
+            if (item == NULL || pool_items[i].last_used_ticks < item->last_used_ticks) {
+                item = &pool_items[i];
+            }
+        }
+        if (item && item->client) {
+            esp_http_client_cleanup(item->client);
+            item->client = NULL;
+        }
+    }
+
+    if (item->client) {
+        esp_http_client_set_url(item->client, url);
+        esp_http_client_set_method(item->client, HTTP_METHOD_GET);
+        ESP_LOGD(TAG, "reuse client for %s", host_key);
+    } else {
+        item->client = http_pool_client_create(url, item);
+        strcpy(item->host_key, host_key);
+    }
+
+    if (item->client == NULL) {
+        xSemaphoreGive(pool_lock);
+        xSemaphoreGive(pool_available);
+        ESP_LOGE(TAG, "Init http client failed");
+        return NULL;
+    }
+    item->in_use = true;
+    xSemaphoreGive(pool_lock);
+    return item->client;
+}
+
+// 重定向到其他主机后连接已经指向新主机，按新地址更新主机键，之后同一主机的请求才能复用它
+static void http_pool_rekey(http_pool_item_t* item) {
+    char url[HTTP_POOL_HOST_KEY_SIZE];
+    char host_key[HTTP_POOL_HOST_KEY_SIZE];
+    // 只需要 scheme://host，地址超长被截断不影响主机部分
+    if (esp_http_client_get_url(item->client, url, sizeof(url)) != ESP_OK) {
+        return;
+    }
+    http_pool_get_host_key(url, host_key, sizeof(host_key));
+    if (strcmp(host_key, item->host_key) == 0) {
+        return;
+    }
+    xSemaphoreTake(pool_lock, portMAX_DELAY);
+    ESP_LOGI(TAG, "redirect %s -> %s", item->host_key, host_key);
+    strcpy(item->host_key, host_key);
+    xSemaphoreGive(pool_lock);
+}
+
+esp_err_t http_pool_open(esp_http_client_handle_t client, int64_t* content_length) {
+    http_pool_item_t* item = NULL;
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (pool_items[i].client == client) {
+            item = &pool_items[i];
+            break;
+        }
+    }
+
+    uint8_t retry = 0;
+    uint8_t redirect = 0;
+    while (retry < 2 && redirect <= HTTP_POOL_MAX_REDIRECT) {
+        if (item) {
+            item->open_start_us = esp_timer_get_time();
+        }
+        esp_err_t err = esp_http_client_open(client, 0);
+        int64_t len = ESP_FAIL;
+        if (err == ESP_OK) {
+            len = esp_http_client_fetch_headers(client);
+        }
+        if (err != ESP_OK || (len < 0 && esp_http_client_is_chunked_response(client) == false)) {
+            // 复用的连接可能已被服务器关闭，重连一次
+            ESP_LOGW(TAG, "open failed: %s, retry %d", esp_err_to_name(err), retry);
+            esp_http_client_close(client);
+            retry += 1;
+            continue;
+        }
+
+        int status_code = esp_http_client_get_status_code(client);
+        if (status_code == 301 || status_code == 302 || status_code == 307 || status_code == 308) {
+            esp_http_client_flush_response(client, NULL);
+            esp_http_client_set_redirection(client);
+            redirect += 1;
+            continue;
+        }
+        if (status_code != 200 && status_code != 206) {
+            ESP_LOGE(TAG, "http status code: %d", status_code);
+            return ESP_FAIL;
+        }
+
+        if (redirect > 0 && item) {
+            http_pool_rekey(item);
+        }
+        if (content_length) {
+            *content_length = len;
+        }
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+void http_pool_get_stats(http_pool_stats_t* stats) {
+    if (stats) {
+        memcpy(stats, &pool_stats, sizeof(http_pool_stats_t));
+    }
+}
+
+void http_pool_release(esp_http_client_handle_t client, bool reusable) {
+    if (client == NULL) {
+        return;
+    }
+    if (reusable == false) {
+        esp_http_client_close(client);
+    }
+    esp_http_client_delete_header(client, "Range");
+
+    xSemaphoreTake(pool_lock, portMAX_DELAY);
+    for (int i = 0; i < HTTP_POOL_SIZE; i++) {
+        if (pool_items[i].client == client) {
+            pool_items[i].in_use = false;
+            pool_items[i].last_used_ticks = xTaskGetTickCount();
+            break;
+        }
+    }
+    xSemaphoreGive(pool_lock);
+    xSemaphoreGive(pool_available);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+/** @brief 连接池大小，按 scheme://host:port 复用 */
+#define HTTP_POOL_SIZE 3
+/** @brief 空闲连接保留时间(ms)，超时后下次借用时重新建连，句柄中的TLS会话保留用于恢复握手 */
+#define HTTP_POOL_IDLE_TIMEOUT_MS 30000
+
+/**
+ * @brief 连接池建连耗时统计
+ * @note 只统计真正建立的连接，复用的 keep-alive 连接不计入
+ */
+typedef struct {
+    uint32_t tcp_connect_count;     // http 建连次数
+    uint32_t tls_connect_count;     // https 建连次数(含TLS握手)
+    uint32_t tls_connect_last_ms;   // 最近一次 TCP + TLS 握手耗时
+    uint32_t tls_connect_total_ms;  // TCP + TLS 握手累计耗时
+} http_pool_stats_t;
+
+/**
+ * @brief 初始化HTTP连接池
+ * @note 可重复调用
+ */
+void http_pool_init(void);
+
+/**
+ * @brief 借用一个指向 url 所在主机的 HTTP 客户端
+ * @param url 请求地址
+ * @param timeout_ms 等待空闲连接的超时时间
+ * @return 客户端句柄，失败返回 NULL
+ * @note 优先复用同一主机上保持连接(keep-alive)的客户端，避免重复的 TCP/TLS 握手
+ */
+esp_http_client_handle_t http_pool_acquire(const char* url, uint32_t timeout_ms);
+
+/**
+ * @brief 发送请求并读取响应头
+ * @param client 通过 http_pool_acquire 借用的客户端
+ * @param content_length 输出参数，响应长度，chunked 时为 -1，可为 NULL
+ * @return ESP_OK 成功，其他值表示失败
+ * @note 复用的连接可能已被服务器关闭，此时自动重连重试一次
+ */
+esp_err_t http_pool_open(esp_http_client_handle_t client, int64_t* content_length);
+
+/**
+ * @brief 获取建连耗时统计
+ * @param stats 输出参数
+ */
+void http_pool_get_stats(http_pool_stats_t* stats);
+
+/**
+ * @brief 归还客户端
+ * @param client 客户端句柄
+ * @param reusable 响应是否已完整读取，只有完整读取的连接才能继续复用
+ */
+void http_pool_release(esp_http_client_handle_t client, bool reusable);
@@ -1,22 +1,39 @@
 #include <stdio.h>
+#include <string.h>
 
 #include "aiha_websocket.h"
 #include "audio_player_user.h"
+#include "boot_stage.h"
 #include "chat_notify.h"
 #include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_wifi.h"
 #include "nvs_flash.h"
 #include "qmsd_prov_wifi.h"
 #include "qmsd_utils.h"
 #include "qmsd_wifi.h"
+#include "qmsd_wifi_ps.h"
 #include "qmsd_wifi_sta.h"
 #include "storage_nvs.h"
 #include "qmsd_ota.h"
 #include "qmsd_network.h"
 
-wifi_config_t* wifi_cfg;
+static wifi_config_t wifi_cfg;
 
 #define TAG "qmsd.net"
 
+#define NETWORK_FAST_KEY "wifiFast"
+#define NETWORK_FAST_MAGIC 0x54534146  // "FAST"
+
+// 上次连接成功的 AP，开机时按它的信道和 BSSID 直接连接，省去全信道扫描
+typedef struct {
+    uint32_t magic;
+    uint32_t cfg_crc;  // ssid 和密码的 crc，重新配网后自动失效
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;
+} network_fast_t;
+
 static void wifi_cfg_via_blufi_task(void* arg) {
     chat_notify_audio_play(NOTIFY_NOT_BIND, NULL);
     qmsd_wifi_sta_set_reconnect_times(4, 4, 4);
@@ -62,7 +79,7 @@ static void wifi_cfg_via_blufi_task(void* arg) {
 
 bool qmsd_network_get_need_bind() {
     uint32_t len = sizeof(wifi_config_t);
-    if (storage_nvs_read_blob("wifiCfg", (void**)&wifi_cfg, &len) != ESP_OK) {
+    if (storage_nvs_read_blob_to("wifiCfg", &wifi_cfg, &len) != ESP_OK || len != sizeof(wifi_config_t)) {
         return true;
     }
     return false;
@@ -75,6 +92,75 @@ bool qmsd_network_get_connected() {
     return true;
 }
 
+static uint32_t network_cfg_crc(void) {
+    uint32_t crc = esp_rom_crc32_le(0, wifi_cfg.sta.ssid, sizeof(wifi_cfg.sta.ssid));
+    return esp_rom_crc32_le(crc, wifi_cfg.sta.password, sizeof(wifi_cfg.sta.password));
+}
+
+static bool network_fast_load(network_fast_t* fast) {
+    uint32_t len = sizeof(network_fast_t);
+    if (storage_nvs_read_blob_to(NETWORK_FAST_KEY, fast, &len) != ESP_OK || len != sizeof(network_fast_t)) {
+        return false;
+    }
+    return fast->magic == NETWORK_FAST_MAGIC && fast->cfg_crc == network_cfg_crc() && fast->channel != 0;
+}
+
+// 连接成功后记录当前 AP，没有变化时不写 flash
+static void network_fast_save(void) {
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return;
+    }
+    network_fast_t fast = {
+        .magic = NETWORK_FAST_MAGIC,
+        .cfg_crc = network_cfg_crc(),
+        .channel = ap_info.primary,
+        .authmode = ap_info.authmode,
+    };
+    memcpy(fast.bssid, ap_info.bssid, sizeof(fast.bssid));
+
+    network_fast_t old;
+    if (network_fast_load(&old) && memcmp(&old, &fast, sizeof(network_fast_t)) == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "save ap " MACSTR ", channel: %d", MAC2STR(fast.bssid), fast.channel);
+    storage_nvs_write_blob(NETWORK_FAST_KEY, &fast, sizeof(network_fast_t));
+}
+
+/**
+ * @brief 按缓存的 AP 信息快速连接
+ * @return true 连接成功(已获取 IP)，false 没有缓存或者连接失败，需要全信道扫描连接
+ * @note 只在缓存的信道上连接指定 BSSID，不重试。IP 由 CONFIG_LWIP_DHCP_RESTORE_LAST_IP 恢复上次的租约，
+ *       DHCP 直接请求原地址，省去 DISCOVER/OFFER
+ */
+static bool network_fast_connect(void) {
+    network_fast_t fast;
+    if (!network_fast_load(&fast)) {
+        return false;
+    }
+    wifi_config_t fast_cfg = wifi_cfg;
+    memcpy(fast_cfg.sta.bssid, fast.bssid, sizeof(fast.bssid));
+    fast_cfg.sta.bssid_set = true;
+    fast_cfg.sta.channel = fast.channel;
+    fast_cfg.sta.scan_method = WIFI_FAST_SCAN;
+    fast_cfg.sta.threshold.authmode = fast.authmode;
+
+    ESP_LOGI(TAG, "fast connect " MACSTR ", channel: %d", MAC2STR(fast.bssid), fast.channel);
+    qmsd_wifi_sta_set_reconnect_times(0, 0, 0);
+    if (qmsd_wifi_sta_connect(&fast_cfg, WIFI_BW_HT20, QMSD_NETWORK_FAST_CONNECT_TIMEOUT_MS) == STA_CONNECTED) {
+        // 之后的断线重连不锁定 BSSID，AP 更换后仍能连上，保留信道作为扫描起点
+        wifi_cfg.sta.channel = fast.channel;
+        esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg);
+        return true;
+    }
+
+    ESP_LOGW(TAG, "fast connect failed, fall back to full scan");
+    storage_nvs_erase_key(NETWORK_FAST_KEY);
+    qmsd_wifi_sta_disconnect();
+    esp_wifi_stop();
+    return false;
+}
+
 void qmsd_network_task(void* arg) {
     uint8_t g_wifi_need_cfg = 0;
     qmsd_network_connect_success_cb_t success_cb = (qmsd_network_connect_success_cb_t)arg;
@@ -84,27 +170,50 @@ void qmsd_network_task(void* arg) {
 
     g_wifi_need_cfg = qmsd_network_get_need_bind();
     if (g_wifi_need_cfg) {
+        boot_stage_wait(BOOT_STAGE_BIT(BOOT_STAGE_NOTIFY), portMAX_DELAY);
         audio_player_wait_idle(10000);
         wifi_cfg_via_blufi_task(NULL);
     }
     
+    // 监听间隔在关联时协商，空闲省电时生效
+    wifi_cfg.sta.listen_interval = QMSD_WIFI_PS_LISTEN_INTERVAL;
+    boot_stage_begin(BOOT_STAGE_WIFI);
+    uint32_t connect_begin_ticks = xTaskGetTickCount();
+    uint32_t connect_start_ticks = connect_begin_ticks;
+    bool fast = network_fast_connect();
     qmsd_wifi_sta_set_reconnect_times(-1, -1, -1);
-    uint32_t connect_start_ticks = xTaskGetTickCount();
-    qmsd_wifi_sta_connect(wifi_cfg, WIFI_BW_HT20, 0);
+    if (!fast) {
+        qmsd_wifi_sta_connect(&wifi_cfg, WIFI_BW_HT20, 0);
+    }
 
     while (qmsd_wifi_sta_get_status() != STA_CONNECTED) {
-        if (connect_start_ticks && xTaskGetTickCount() - connect_start_ticks > pdMS_TO_TICKS(10000)) {
+        if (connect_start_ticks && xTaskGetTickCount() - connect_start_ticks > pdMS_TO_TICKS(10000) &&
+            boot_stage_wait(BOOT_STAGE_BIT(BOOT_STAGE_NOTIFY), 0)) {
             chat_notify_audio_play(NOTIFY_WIFI_SERVER_ERROR, NULL);
             connect_start_ticks = 0;
         }
         vTaskDelay(pdMS_TO_TICKS(100));
     }
+    ESP_LOGI(TAG, "%s connected in %lu ms", fast ? "fast" : "scan",
+             pdTICKS_TO_MS(xTaskGetTickCount() - connect_begin_ticks));
+    boot_stage_done(BOOT_STAGE_WIFI);
+    network_fast_save();
+
+    // 启动时联网可能比提示音模块更快，等开机提示音排队后再播放联网成功
+    boot_stage_wait(BOOT_STAGE_BIT(BOOT_STAGE_NOTIFY), portMAX_DELAY);
     audio_player_wait_idle(10000);
     chat_notify_audio_play(NOTIFY_CONNECT_SUCCESS, NULL);
+    boot_stage_done(BOOT_STAGE_PROMPT);
+
     qmsd_check_ota_by_http();
+    // 对话服务需要配置语音芯片，等它启动完成
+    boot_stage_wait(BOOT_STAGE_BIT(BOOT_STAGE_GX8006), portMAX_DELAY);
+    boot_stage_begin(BOOT_STAGE_CHAT);
     if (success_cb) {
         success_cb();
     }
+    boot_stage_done(BOOT_STAGE_CHAT);
+    qmsd_wifi_ps_start();
 
     vTaskDelete(NULL);
 }
@@ -3,6 +3,9 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+/** @brief 按缓存的 AP 快速连接的超时时间(包含获取 IP)，超时后改为全信道扫描连接 */
+#define QMSD_NETWORK_FAST_CONNECT_TIMEOUT_MS 4000
+
 /**
  * @brief 网络连接成功回调函数类型
  * @note 当Wi-Fi连接成功时会被调用的回调函数
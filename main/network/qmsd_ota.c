@@ -1,18 +1,30 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
 #include <freertos/task.h>
 
 #include "aiha_req_ota.h"
+#include "audio_player_user.h"
 #include "cJSON.h"
 #include "chat_notify.h"
+#include "esp_app_format.h"
 #include "esp_event.h"
 #include "esp_http_client.h"
-#include "esp_https_ota.h"
 #include "esp_log.h"
 #include "esp_ota_ops.h"
+#include "esp_partition.h"
 #include "esp_system.h"
+#include "esp_timer.h"
+#include "gx8006.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include "qmsd_ota.h"
+#include "qmsd_ota_delta.h"
+#include "qmsd_ota_heatshrink.h"
+#include "storage_nvs.h"
 
 #define TAG "qmsd_iothub_ota"
 
@@ -23,117 +35,488 @@ EventGroupHandle_t g_ota_event_group;
 #define OTA_SUCCESS (1 << 2)
 #define OTA_FAILED (1 << 3)
 
+#define OTA_SECTOR_SIZE 4096
+#define OTA_CHECKPOINT_KEY "otaCkpt"
+#define OTA_CHECKPOINT_MAGIC 0x4b43544f  // "OTCK"
+// app 描述在镜像中的偏移: 镜像头 + 第一个段头
+#define OTA_APP_DESC_OFFSET (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t))
+
 typedef struct {
     char url[512];
     uint8_t download_percent;
+    bool background;  // 后台升级，不影响对话
 } iothub_ota_info_t;
 
+// 断点信息，保存在 NVS 中，重启后同一个镜像从 offset 继续下载
+typedef struct {
+    uint32_t magic;
+    uint32_t url_hash;          // 去掉查询参数后的地址，签名参数每次可能不同
+    uint32_t etag_hash;         // 服务器返回的 ETag，没有时为 0
+    uint32_t image_size;        // 镜像总长度
+    uint32_t offset;            // 已写入分区并确认的长度，按扇区对齐
+    uint8_t partition;          // 目标分区 subtype
+    uint8_t elf_sha256[32];     // 镜像 app 描述中的 elf sha256，全 0 表示还没下载到
+} ota_checkpoint_t;
+
+typedef struct {
+    const esp_partition_t* partition;
+    ota_checkpoint_t ckpt;
+    uint32_t pos;         // 当前写入位置
+    uint32_t erased_end;  // 已擦除到的位置
+    uint32_t recv;        // 已接收的下载数据长度，完整镜像时与 pos 相同
+    uint32_t decoded;     // 解压后的数据长度，没有压缩时与 recv 相同
+    bool resumable;       // 差分包和压缩包的解析状态无法保存，只有完整镜像支持断点
+    qmsd_ota_heatshrink_t* hs;
+    qmsd_ota_delta_t* delta;
+    uint32_t etag_hash;   // 本次请求返回的 ETag
+    uint32_t total_size;  // 本次请求返回的镜像总长度
+    uint32_t tokens;      // 后台升级限速的令牌桶
+    int64_t bucket_time;  // 令牌计算到的时间(us)，0 表示重新开始计算
+} ota_ctx_t;
+
 static iothub_ota_info_t* g_info;
+static volatile qmsd_ota_state_t ota_state = QMSD_OTA_STATE_IDLE;
+static esp_err_t ota_last_err = ESP_OK;
 
 extern esp_err_t esp_crt_bundle_attach(void* conf);
 
-static void ota_task(void* arg) {
-    uint8_t retry = 3;
-    iothub_ota_info_t* ota_info = (iothub_ota_info_t*)arg;
+static uint32_t ota_hash(const char* str, uint32_t len) {
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < len && str[i]; i++) {
+        hash = (hash ^ (uint8_t)str[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t ota_url_hash(const char* url) {
+    const char* query = strchr(url, '?');
+    return ota_hash(url, query ? query - url : strlen(url));
+}
+
+static void ota_checkpoint_save(ota_ctx_t* ctx) {
+    storage_nvs_write_blob(OTA_CHECKPOINT_KEY, &ctx->ckpt, sizeof(ota_checkpoint_t));
+}
+
+static void ota_checkpoint_clear(void) {
+    storage_nvs_erase_key(OTA_CHECKPOINT_KEY);
+}
+
+// 读取断点，只有同一个地址、同一个目标分区且分区内容没有被改写时才续传
+static void ota_checkpoint_load(ota_ctx_t* ctx, const char* url) {
+    ota_checkpoint_t* ckpt = &ctx->ckpt;
+    uint32_t len = sizeof(ota_checkpoint_t);
+    if (storage_nvs_read_blob_to(OTA_CHECKPOINT_KEY, ckpt, &len) == ESP_OK && len == sizeof(ota_checkpoint_t) &&
+        ckpt->magic == OTA_CHECKPOINT_MAGIC && ckpt->url_hash == ota_url_hash(url) &&
+        ckpt->partition == ctx->partition->subtype && ckpt->offset <= ckpt->image_size) {
+        esp_app_desc_t desc;
+        uint8_t empty[32] = { 0 };
+        bool desc_ok = memcmp(ckpt->elf_sha256, empty, sizeof(empty)) == 0 ||
+                       (esp_partition_read(ctx->partition, OTA_APP_DESC_OFFSET, &desc, sizeof(desc)) == ESP_OK &&
+                        memcmp(desc.app_elf_sha256, ckpt->elf_sha256, sizeof(ckpt->elf_sha256)) == 0);
+        if (desc_ok) {
+            ESP_LOGI(TAG, "resume ota from %lu / %lu", ckpt->offset, ckpt->image_size);
+            return;
+        }
+    }
+    memset(ckpt, 0, sizeof(ota_checkpoint_t));
+}
+
+static esp_err_t ota_http_event_handler(esp_http_client_event_t* evt) {
+    ota_ctx_t* ctx = (ota_ctx_t*)evt->user_data;
+    if (evt->event_id != HTTP_EVENT_ON_HEADER) {
+        return ESP_OK;
+    }
+    if (strcasecmp(evt->header_key, "ETag") == 0) {
+        ctx->etag_hash = ota_hash(evt->header_value, strlen(evt->header_value));
+    } else if (strcasecmp(evt->header_key, "Content-Range") == 0) {
+        // bytes <start>-<end>/<total>
+        const char* total = strchr(evt->header_value, '/');
+        ctx->total_size = total ? strtoul(total + 1, NULL, 10) : 0;
+    }
+    return ESP_OK;
+}
+
+// 按扇区边推进边擦除，续传时不会擦掉已经确认的部分
+static esp_err_t ota_partition_write(ota_ctx_t* ctx, const void* data, uint32_t len) {
+    if (ctx->pos + len > ctx->partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (ctx->pos + len > ctx->erased_end) {
+        uint32_t erase_end = (ctx->pos + len + OTA_SECTOR_SIZE - 1) & ~(OTA_SECTOR_SIZE - 1);
+        esp_err_t err = esp_partition_erase_range(ctx->partition, ctx->erased_end, erase_end - ctx->erased_end);
+        if (err != ESP_OK) {
+            return err;
+        }
+        ctx->erased_end = erase_end;
+    }
+    esp_err_t err = esp_partition_write(ctx->partition, ctx->pos, data, len);
+    if (err == ESP_OK) {
+        ctx->pos += len;
+    }
+    return err;
+}
+
+// 新镜像数据写入分区: 检查镜像头、记录 elf sha256
+static esp_err_t ota_output(void* arg, const uint8_t* data, uint32_t len) {
+    ota_ctx_t* ctx = (ota_ctx_t*)arg;
+    ota_checkpoint_t* ckpt = &ctx->ckpt;
+    uint32_t start = ctx->pos;
+    esp_err_t err = ota_partition_write(ctx, data, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (start < sizeof(esp_image_header_t) && ctx->pos >= sizeof(esp_image_header_t)) {
+        esp_image_header_t header;
+        esp_partition_read(ctx->partition, 0, &header, sizeof(header));
+        if (header.magic != ESP_IMAGE_HEADER_MAGIC || header.chip_id != CONFIG_IDF_FIRMWARE_CHIP_ID) {
+            ESP_LOGE(TAG, "invalid image header, magic: 0x%02x, chip: %d", header.magic, header.chip_id);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    if (start < OTA_APP_DESC_OFFSET + sizeof(esp_app_desc_t) && ctx->pos >= OTA_APP_DESC_OFFSET + sizeof(esp_app_desc_t)) {
+        esp_app_desc_t desc;
+        esp_partition_read(ctx->partition, OTA_APP_DESC_OFFSET, &desc, sizeof(desc));
+        memcpy(ckpt->elf_sha256, desc.app_elf_sha256, sizeof(ckpt->elf_sha256));
+        ESP_LOGI(TAG, "new firmware version: %s", desc.version);
+    }
+    return ESP_OK;
+}
+
+// 解压后的数据: 完整镜像直接写入，差分包经过解析后写入
+static esp_err_t ota_decoded(void* arg, const uint8_t* data, uint32_t len) {
+    ota_ctx_t* ctx = (ota_ctx_t*)arg;
+    if (ctx->decoded == 0 && qmsd_ota_delta_check(data, len)) {
+        ctx->delta = qmsd_ota_delta_create(ota_output, ctx);
+        if (ctx->delta == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        ctx->resumable = false;
+    }
+    ctx->decoded += len;
+    return ctx->delta ? qmsd_ota_delta_feed(ctx->delta, data, len) : ota_output(ctx, data, len);
+}
+
+// 处理一段下载数据: 压缩包先解压；定期保存断点
+static esp_err_t ota_received(ota_ctx_t* ctx, iothub_ota_info_t* ota_info, const uint8_t* data, uint32_t len) {
+    ota_checkpoint_t* ckpt = &ctx->ckpt;
+    if (ctx->recv == 0 && qmsd_ota_heatshrink_check(data, len)) {
+        ctx->hs = qmsd_ota_heatshrink_create(ota_decoded, ctx);
+        if (ctx->hs == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        ctx->resumable = false;
+    }
+    ctx->recv += len;
+    esp_err_t err = ctx->hs ? qmsd_ota_heatshrink_feed(ctx->hs, data, len) : ota_decoded(ctx, data, len);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (ctx->resumable && ctx->pos - ckpt->offset >= QMSD_OTA_CHECKPOINT_SIZE) {
+        ckpt->offset = ctx->pos & ~(OTA_SECTOR_SIZE - 1);
+        ota_checkpoint_save(ctx);
+    }
+
+    uint8_t now_percent = (uint64_t)ctx->recv * 100 / ckpt->image_size;
+    if ((now_percent / 10) != (ota_info->download_percent / 10)) {
+        ESP_LOGI(TAG, "Image bytes read: %d %%", now_percent);
+    }
+    ota_info->download_percent = now_percent;
+    return ESP_OK;
+}
+
+// 后台升级按令牌桶限速，返回本次可以读取的长度
+static uint32_t ota_throttle(ota_ctx_t* ctx) {
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        if (ctx->bucket_time == 0) {
+            ctx->bucket_time = now;
+        }
+        uint32_t added = (now - ctx->bucket_time) * QMSD_OTA_BACKGROUND_RATE / 1000000;
+        ctx->tokens += added;
+        ctx->bucket_time += (int64_t)added * 1000000 / QMSD_OTA_BACKGROUND_RATE;
+        if (ctx->tokens >= QMSD_OTA_BUFFER_SIZE) {
+            ctx->tokens = QMSD_OTA_BUFFER_SIZE;
+            ctx->bucket_time = now;
+        }
+        if (ctx->tokens >= QMSD_OTA_BUFFER_SIZE / 4) {
+            return ctx->tokens;
+        }
+        vTaskDelay(pdMS_TO_TICKS((QMSD_OTA_BUFFER_SIZE / 4 - ctx->tokens) * 1000 / QMSD_OTA_BACKGROUND_RATE + 1));
+    }
+}
 
-ota_restart:
-    ESP_LOGI(TAG, "Starting Advanced OTA");
+// 下载一次，从断点处开始，返回 ESP_OK 表示镜像已完整写入
+static esp_err_t ota_download(ota_ctx_t* ctx, iothub_ota_info_t* ota_info, char* buffer) {
+    ota_checkpoint_t* ckpt = &ctx->ckpt;
     esp_http_client_config_t config = {
         .url = ota_info->url,
-        .timeout_ms = 600000,
-        .buffer_size = 4096,
+        .timeout_ms = QMSD_OTA_HTTP_TIMEOUT_MS,
+        .buffer_size = QMSD_OTA_BUFFER_SIZE,
         .keep_alive_enable = true,
-        .user_data = ota_info,
+        .user_data = ctx,
+        .event_handler = ota_http_event_handler,
         .crt_bundle_attach = esp_crt_bundle_attach,
     };
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        return ESP_FAIL;
+    }
+    if (ckpt->offset > 0) {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%lu-", ckpt->offset);
+        esp_http_client_set_header(client, "Range", range);
+    }
+    ctx->etag_hash = 0;
+    ctx->total_size = 0;
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    int64_t content_length = err == ESP_OK ? esp_http_client_fetch_headers(client) : -1;
+    int status_code = esp_http_client_get_status_code(client);
+    if (err != ESP_OK || content_length < 0) {
+        ESP_LOGE(TAG, "open failed: %s, status: %d", esp_err_to_name(err), status_code);
+        esp_http_client_cleanup(client);
+        return ESP_FAIL;
+    }
 
-    esp_https_ota_config_t ota_config = {
-        .http_config = &config,
+    if (ckpt->offset > 0) {
+        // 续传必须是同一个镜像，否则从头下载
+        if (status_code != 206 || ctx->total_size != ckpt->image_size || (ckpt->etag_hash && ctx->etag_hash != ckpt->etag_hash)) {
+            ESP_LOGW(TAG, "resume rejected, status: %d, size: %lu / %lu", status_code, ctx->total_size, ckpt->image_size);
+            memset(ckpt, 0, sizeof(ota_checkpoint_t));
+            esp_http_client_cleanup(client);
+            return ESP_ERR_INVALID_STATE;
+        }
+    } else {
+        if (status_code != 200 || content_length == 0 || content_length > ctx->partition->size) {
+            ESP_LOGE(TAG, "invalid response, status: %d, length: %lld", status_code, content_length);
+            esp_http_client_cleanup(client);
+            return status_code == 200 ? ESP_ERR_INVALID_SIZE : ESP_FAIL;
+        }
+        ckpt->magic = OTA_CHECKPOINT_MAGIC;
+        ckpt->url_hash = ota_url_hash(ota_info->url);
+        ckpt->etag_hash = ctx->etag_hash;
+        ckpt->image_size = content_length;
+        ckpt->partition = ctx->partition->subtype;
+        memset(ckpt->elf_sha256, 0, sizeof(ckpt->elf_sha256));
+    }
+    ctx->pos = ckpt->offset;
+    ctx->erased_end = ckpt->offset;
+    ctx->recv = ckpt->offset;
+    ctx->decoded = ckpt->offset;
+    ctx->resumable = true;
 
-    };
+    err = ESP_OK;
+    while (ctx->recv < ckpt->image_size) {
+        if (ota_info->background && gx8006_in_wakeup()) {
+            // 对话期间不保持连接，暂停太久服务器会断开，恢复后读取必然失败
+            err = ESP_ERR_NOT_FINISHED;
+            break;
+        }
+        uint32_t read_len = ota_info->background ? ota_throttle(ctx) : QMSD_OTA_BUFFER_SIZE;
+        int len = esp_http_client_read(client, buffer, read_len);
+        if (ota_info->background && len > 0) {
+            ctx->tokens -= len;
+        }
+        if (len <= 0) {
+            ESP_LOGE(TAG, "read failed at %lu: %d", ctx->recv, len);
+            err = ESP_FAIL;
+            break;
+        }
+        err = ota_received(ctx, ota_info, (const uint8_t*)buffer, len);
+        if (err != ESP_OK) {
+            break;
+        }
+    }
+    esp_http_client_cleanup(client);
+    // 压缩包和差分包先校验解压结果和完整镜像的 sha256，失败时下次从头下载
+    if (ctx->hs) {
+        if (err == ESP_OK) {
+            err = qmsd_ota_heatshrink_finish(ctx->hs);
+        }
+        qmsd_ota_heatshrink_destroy(ctx->hs);
+        ctx->hs = NULL;
+    }
+    if (ctx->delta) {
+        if (err == ESP_OK) {
+            err = qmsd_ota_delta_finish(ctx->delta);
+        }
+        qmsd_ota_delta_destroy(ctx->delta);
+        ctx->delta = NULL;
+    }
+    return err;
+}
 
-    esp_https_ota_handle_t https_ota_handle = NULL;
-    esp_err_t err = esp_https_ota_begin(&ota_config, &https_ota_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "ESP HTTPS OTA Begin failed");
-        retry -= 1;
-        if (retry > 0) {
-            vTaskDelay(pdMS_TO_TICKS(2000));
-            goto ota_restart;
+// 对话结束后继续下载，暂停期间连接已关闭
+static void ota_wait_chat_end(ota_ctx_t* ctx) {
+    ESP_LOGI(TAG, "pause download at %lu, resume from %lu", ctx->recv, ctx->ckpt.offset);
+    ota_state = QMSD_OTA_STATE_PAUSED;
+    while (gx8006_in_wakeup()) {
+        vTaskDelay(pdMS_TO_TICKS(QMSD_OTA_PAUSE_CHECK_MS));
+    }
+    ota_state = QMSD_OTA_STATE_DOWNLOADING;
+    ESP_LOGI(TAG, "resume download");
+    // 暂停期间不积累令牌，恢复后不会突发
+    ctx->tokens = 0;
+    ctx->bucket_time = 0;
+}
+
+// 后台升级连续失败后不放弃，隔一段时间重新请求升级地址(签名地址可能已过期)，从断点继续
+static esp_err_t ota_wait_retry(ota_ctx_t* ctx, iothub_ota_info_t* ota_info) {
+    ESP_LOGW(TAG, "background ota retry in %d ms, checkpoint at %lu", QMSD_OTA_BACKGROUND_RETRY_MS, ctx->ckpt.offset);
+    ota_state = QMSD_OTA_STATE_RETRY_WAIT;
+    vTaskDelay(pdMS_TO_TICKS(QMSD_OTA_BACKGROUND_RETRY_MS));
+    const char* url = NULL;
+    if (aiha_ota_req_url(SOFT_VERSION) != ESP_OK || (url = aiha_ota_get_url()) == NULL ||
+        strlen(url) >= sizeof(ota_info->url)) {
+        ESP_LOGE(TAG, "background ota no longer available");
+        return ESP_ERR_NOT_FOUND;
+    }
+    strcpy(ota_info->url, url);
+    // 地址对应的镜像变了时断点失效，从头下载
+    ota_checkpoint_load(ctx, ota_info->url);
+    ota_state = QMSD_OTA_STATE_DOWNLOADING;
+    return ESP_OK;
+}
+
+// 后台升级完成后，等到连续空闲(没有对话、没有播放)一段时间再重启
+static void ota_restart_when_idle(void) {
+    int64_t idle_since = esp_timer_get_time();
+    ESP_LOGI(TAG, "wait idle to restart");
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        if (gx8006_in_wakeup() || audio_player_in_running()) {
+            idle_since = now;
+        } else if (now - idle_since >= QMSD_OTA_RESTART_IDLE_MS * 1000LL) {
+            break;
         }
-        xEventGroupSetBits(g_ota_event_group, OTA_FAILED);
-        vTaskDelete(NULL);
+        vTaskDelay(pdMS_TO_TICKS(1000));
     }
+    ESP_LOGI(TAG, "idle, restart to new firmware");
+    esp_restart();
+}
 
-    esp_app_desc_t app_desc;
-    err = esp_https_ota_get_img_desc(https_ota_handle, &app_desc);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "esp_https_ota_read_img_desc failed");
+static void ota_task(void* arg) {
+    iothub_ota_info_t* ota_info = (iothub_ota_info_t*)arg;
+    ota_ctx_t* ctx = heap_caps_calloc(1, sizeof(ota_ctx_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    char* buffer = heap_caps_malloc(QMSD_OTA_BUFFER_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    esp_err_t err = ESP_ERR_NO_MEM;
+    bool keep_checkpoint = false;
+    uint8_t retry = 0;
+    uint32_t delay_ms = QMSD_OTA_RETRY_DELAY_MIN_MS;
+    if (ctx == NULL || buffer == NULL) {
+        goto ota_end;
+    }
+    ctx->partition = esp_ota_get_next_update_partition(NULL);
+    if (ctx->partition == NULL) {
+        err = ESP_ERR_NOT_FOUND;
         goto ota_end;
     }
 
-    while (1) {
-        err = esp_https_ota_perform(https_ota_handle);
-        if (err != ESP_ERR_HTTPS_OTA_IN_PROGRESS) {
+    ESP_LOGI(TAG, "Starting resumable OTA to %s%s", ctx->partition->label, ota_info->background ? " in background" : "");
+    ota_checkpoint_load(ctx, ota_info->url);
+
+    for (;;) {
+        uint32_t start = ctx->ckpt.offset;
+        err = ota_download(ctx, ota_info, buffer);
+        if (err == ESP_OK || err == ESP_ERR_NOT_SUPPORTED || err == ESP_ERR_INVALID_SIZE || err == ESP_ERR_INVALID_VERSION ||
+            err == ESP_ERR_INVALID_ARG || err == ESP_ERR_OTA_VALIDATE_FAILED) {
             break;
         }
-        if (esp_https_ota_get_image_size(https_ota_handle) != 0) {
-            uint8_t now_percent = esp_https_ota_get_image_len_read(https_ota_handle) * 100 / esp_https_ota_get_image_size(https_ota_handle);
-            if ((now_percent / 10) != (ota_info->download_percent / 10)) {
-                ESP_LOGI(TAG, "Image bytes read: %d %%", now_percent);
+        if (err == ESP_ERR_INVALID_STATE) {
+            // 断点无效，立即从头下载
+            continue;
+        }
+        // 有进展时重新计数，只有连续失败才放弃；断点保留到下次启动继续。差分包每次从头下载，不算进展
+        if (ctx->resumable && ctx->pos > start) {
+            retry = 0;
+            delay_ms = QMSD_OTA_RETRY_DELAY_MIN_MS;
+            ctx->ckpt.offset = ctx->pos & ~(OTA_SECTOR_SIZE - 1);
+            ota_checkpoint_save(ctx);
+        }
+        if (err == ESP_ERR_NOT_FINISHED) {
+            // 对话引起的暂停不是失败，不计入重试次数
+            ota_wait_chat_end(ctx);
+            continue;
+        }
+        retry += 1;
+        if (retry >= QMSD_OTA_RETRY_MAX) {
+            if (ota_info->background && ota_wait_retry(ctx, ota_info) == ESP_OK) {
+                retry = 0;
+                delay_ms = QMSD_OTA_RETRY_DELAY_MIN_MS;
+                continue;
             }
-            ota_info->download_percent = now_percent;
+            ESP_LOGE(TAG, "give up, keep checkpoint at %lu", ctx->ckpt.offset);
+            keep_checkpoint = true;
+            break;
         }
+        ESP_LOGW(TAG, "retry %d in %lu ms from %lu", retry, delay_ms, ctx->ckpt.offset);
+        vTaskDelay(pdMS_TO_TICKS(delay_ms));
+        delay_ms = delay_ms * 2 > QMSD_OTA_RETRY_DELAY_MAX_MS ? QMSD_OTA_RETRY_DELAY_MAX_MS : delay_ms * 2;
     }
 
-    if (esp_https_ota_is_complete_data_received(https_ota_handle) != true) {
-        ESP_LOGE(TAG, "Complete data was not received.");
-        goto ota_end;
+    if (err == ESP_OK) {
+        // 设置启动分区时会校验整个镜像(包括镜像末尾的 sha256)，拼接错误的镜像在这里被拒绝
+        err = esp_ota_set_boot_partition(ctx->partition);
     }
 
-    esp_err_t ota_finish_err = esp_https_ota_finish(https_ota_handle);
-    if ((err == ESP_OK) && (ota_finish_err == ESP_OK)) {
+ota_end:
+    if (keep_checkpoint == false) {
+        ota_checkpoint_clear();
+    }
+    heap_caps_free(ctx);
+    heap_caps_free(buffer);
+    ota_last_err = err;
+    ota_state = err == ESP_OK ? QMSD_OTA_STATE_SUCCESS : QMSD_OTA_STATE_FAILED;
+    if (err == ESP_OK) {
         ESP_LOGI(TAG, "ESP_HTTPS_OTA upgrade successful. Wait rebooting ...");
         xEventGroupSetBits(g_ota_event_group, OTA_SUCCESS);
+        if (ota_info->background) {
+            ota_restart_when_idle();
+        }
     } else {
-        if (ota_finish_err == ESP_ERR_OTA_VALIDATE_FAILED) {
+        if (err == ESP_ERR_OTA_VALIDATE_FAILED) {
             ESP_LOGE(TAG, "Image validation failed, image is corrupted");
         }
-        ESP_LOGE(TAG, "ESP_HTTPS_OTA upgrade failed 0x%x", ota_finish_err);
+        ESP_LOGE(TAG, "ESP_HTTPS_OTA upgrade failed 0x%x", err);
         xEventGroupSetBits(g_ota_event_group, OTA_FAILED);
     }
     xEventGroupClearBits(g_ota_event_group, OTA_START);
     vTaskDelete(NULL);
-
-ota_end:
-    esp_https_ota_abort(https_ota_handle);
-    https_ota_handle = NULL;
-    ESP_LOGE(TAG, "ESP_HTTPS_OTA upgrade failed");
-    retry -= 1;
-    if (retry > 0) {
-        vTaskDelay(pdMS_TO_TICKS(2000));
-        goto ota_restart;
-    }
-    xEventGroupSetBits(g_ota_event_group, OTA_FAILED);
-    xEventGroupClearBits(g_ota_event_group, OTA_START);
-    vTaskDelete(NULL);
 }
 
-esp_err_t ota_start(const char* url) {
+esp_err_t ota_start(const char* url, bool background) {
     // printf("url:%s \n", url);
-    g_ota_event_group = xEventGroupCreate();
+    // 事件组只创建一次，OTA_START 位才能挡住正在下载时的第二次启动
+    if (g_ota_event_group == NULL) {
+        g_ota_event_group = xEventGroupCreate();
+        if (g_ota_event_group == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
 
-    if (xEventGroupGetBits(g_ota_event_group) & OTA_START || url == NULL) {
+    if (xEventGroupGetBits(g_ota_event_group) & OTA_START || url == NULL || strlen(url) >= sizeof(g_info->url)) {
         return ESP_FAIL;
     }
     if (g_info == NULL) {
         g_info = heap_caps_malloc(sizeof(iothub_ota_info_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (g_info == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
     }
     g_info->download_percent = 0;
+    g_info->background = background;
     strcpy(g_info->url, url);
+    ota_state = QMSD_OTA_STATE_DOWNLOADING;
+    ota_last_err = ESP_OK;
     xEventGroupSetBits(g_ota_event_group, OTA_START);
     xEventGroupClearBits(g_ota_event_group, OTA_SUCCESS | OTA_FAILED);
-    xTaskCreatePinnedToCore(ota_task, "ota_task", 4 * 1024, g_info, 7, NULL, 0);
+    // 后台升级使用低优先级，不抢占音频和对话
+    if (xTaskCreatePinnedToCore(ota_task, "ota_task", 4 * 1024, g_info, background ? QMSD_OTA_BACKGROUND_PRIORITY : 7, NULL, 0) != pdPASS) {
+        xEventGroupClearBits(g_ota_event_group, OTA_START);
+        ota_state = QMSD_OTA_STATE_FAILED;
+        ota_last_err = ESP_ERR_NO_MEM;
+        return ESP_ERR_NO_MEM;
+    }
     return ESP_OK;
 }
 
@@ -146,10 +529,14 @@ void qmsd_ota_get_status(uint8_t* percent, uint8_t* status) {
     if (g_ota_event_group == NULL) {
         *percent = 0;
         *status = 0;
+        return;
     }
     *percent = g_info->download_percent;
     EventBits_t bits = xEventGroupGetBits(g_ota_event_group);
-    if (bits & OTA_SUCCESS) {
+    if (g_info->background) {
+        // 后台升级对外始终是未升级状态，对话和灯效不受影响，下载状态和失败原因由 qmsd_ota_get_state 查询
+        *status = 0;
+    } else if (bits & OTA_SUCCESS) {
         *status = 1;
     } else if (bits & OTA_FAILED) {
         *status = 2;
@@ -158,13 +545,29 @@ void qmsd_ota_get_status(uint8_t* percent, uint8_t* status) {
     }
 }
 
+bool qmsd_ota_in_progress(void) {
+    // 等待稍后重试期间不占用网络
+    return ota_state == QMSD_OTA_STATE_DOWNLOADING || ota_state == QMSD_OTA_STATE_PAUSED;
+}
+
+qmsd_ota_state_t qmsd_ota_get_state(esp_err_t* last_err) {
+    if (last_err) {
+        *last_err = ota_last_err;
+    }
+    return ota_state;
+}
+
 void qmsd_check_ota_by_http() {
     if (aiha_ota_req_url(SOFT_VERSION) != ESP_OK) {
         return;
     }
+    if (QMSD_OTA_BACKGROUND) {
+        ota_start(aiha_ota_get_url(), true);
+        return;
+    }
     chat_notify_audio_play(NOTIFY_OTA_START, NULL);
     vTaskDelay(pdMS_TO_TICKS(2000));
-    ota_start(aiha_ota_get_url());
+    ota_start(aiha_ota_get_url(), false);
     uint8_t updata_state = 0;
     uint8_t ota_percent = 0;
     int8_t ota_status = 0;
@@ -1,7 +1,46 @@
 #pragma once
 
+#include <stdbool.h>
+
 #include "esp_err.h"
 
+/** @brief 下载缓冲大小 */
+#define QMSD_OTA_BUFFER_SIZE 4096
+/** @brief 每下载这么多数据保存一次断点到 NVS */
+#define QMSD_OTA_CHECKPOINT_SIZE (64 * 1024)
+/** @brief 单次读取的超时时间(ms) */
+#define QMSD_OTA_HTTP_TIMEOUT_MS 10000
+/** @brief 没有任何进展的连续失败次数上限，超过后放弃，断点保留到下次启动 */
+#define QMSD_OTA_RETRY_MAX 10
+/** @brief 失败重试间隔(ms)，每次失败翻倍 */
+#define QMSD_OTA_RETRY_DELAY_MIN_MS 2000
+#define QMSD_OTA_RETRY_DELAY_MAX_MS 60000
+
+/** @brief 后台升级: 不阻塞联网流程，下载期间可以正常对话，完成后在空闲时重启；为 0 时升级期间拒绝对话 */
+#define QMSD_OTA_BACKGROUND 1
+/** @brief 后台升级的下载限速(字节/秒)，令牌桶容量为一个下载缓冲 */
+#define QMSD_OTA_BACKGROUND_RATE (32 * 1024)
+/** @brief 后台升级任务的优先级 */
+#define QMSD_OTA_BACKGROUND_PRIORITY 2
+/** @brief 对话期间暂停下载并关闭连接，检查对话是否结束的间隔(ms)，暂停不计入失败次数 */
+#define QMSD_OTA_PAUSE_CHECK_MS 200
+/** @brief 后台升级完成后，连续空闲这么久(ms)才重启 */
+#define QMSD_OTA_RESTART_IDLE_MS (60 * 1000)
+/** @brief 后台升级连续失败 QMSD_OTA_RETRY_MAX 次后，隔这么久(ms)重新请求升级地址并从断点继续 */
+#define QMSD_OTA_BACKGROUND_RETRY_MS (30 * 60 * 1000)
+
+/**
+ * @brief 升级下载状态
+ */
+typedef enum {
+    QMSD_OTA_STATE_IDLE = 0,     // 没有升级
+    QMSD_OTA_STATE_DOWNLOADING,  // 正在下载
+    QMSD_OTA_STATE_PAUSED,       // 对话中暂停，连接已关闭，对话结束后继续
+    QMSD_OTA_STATE_RETRY_WAIT,   // 后台升级连续失败，等待稍后重试
+    QMSD_OTA_STATE_SUCCESS,      // 下载完成，等待重启
+    QMSD_OTA_STATE_FAILED,       // 升级失败
+} qmsd_ota_state_t;
+
 /**
  * @brief 获取OTA升级状态信息
  * @param percent 输出参数，存储升级进度百分比（0-100）
@@ -10,8 +49,26 @@
  */
 void qmsd_ota_get_status(uint8_t* percent, uint8_t* status);
 
+/**
+ * @brief 是否正在下载升级(包括后台升级)
+ * @return true 正在下载或对话中暂停，等待稍后重试时返回 false
+ */
+bool qmsd_ota_in_progress(void);
+
+/**
+ * @brief 获取升级下载状态
+ * @param last_err 输出参数，最近一次升级结束的错误码，可为 NULL
+ * @return 下载状态
+ * @note 后台升级时 qmsd_ota_get_status 始终返回未升级，失败只能通过这里查询
+ */
+qmsd_ota_state_t qmsd_ota_get_state(esp_err_t* last_err);
+
 /**
  * @brief 通过HTTP检查OTA升级
- * @note 主动检查是否有新的固件版本可供升级，如果有新版本则自动开始升级流程
+ * @note 主动检查是否有新的固件版本可供升级，如果有新版本则自动开始升级流程。
+ *       QMSD_OTA_BACKGROUND 为 1 时启动后台升级后立即返回，否则阻塞直到重启。
+ *       下载直接写入待升级分区，定期在 NVS 中保存断点，失败重试或重启后用 HTTP Range 从断点继续。
+ *       服务器返回差分包(QDLT)时，以运行分区为源边下载边生成新镜像，校验完整镜像 sha256 后再设置启动分区；
+ *       压缩包(QHSZ，内容为完整镜像或差分包)在固定大小的窗口中边下载边解压。差分包和压缩包不支持断点
  */
 void qmsd_check_ota_by_http();
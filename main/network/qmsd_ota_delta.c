@@ -0,0 +1,205 @@
+#include <string.h>
+
+#include "esp_app_desc.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "mbedtls/sha256.h"
+#include "qmsd_ota_delta.h"
+
+#define TAG "qmsd_ota_delta"
+
+typedef enum {
+    DELTA_STATE_HEADER = 0,
+    DELTA_STATE_OP,
+    DELTA_STATE_ARGS,
+    DELTA_STATE_DATA,
+    DELTA_STATE_DONE,
+} delta_state_t;
+
+struct qmsd_ota_delta {
+    qmsd_ota_delta_output_t output;
+    void* ctx;
+    const esp_partition_t* src;
+    qmsd_ota_delta_header_t header;
+    delta_state_t state;
+    uint8_t op;
+    uint8_t args[8];
+    uint8_t need;         // 头部或参数需要的字节数
+    uint8_t fill;         // 头部或参数已收到的字节数
+    uint32_t src_offset;  // COPY/ADD 当前读取的运行分区位置
+    uint32_t remain;      // 当前操作剩余长度
+    uint32_t out_size;    // 已输出的新镜像长度
+    mbedtls_sha256_context sha;
+    uint8_t window[QMSD_OTA_DELTA_WINDOW_SIZE];
+};
+
+bool qmsd_ota_delta_check(const uint8_t* data, uint32_t len) {
+    uint32_t magic = QMSD_OTA_DELTA_MAGIC;
+    return len >= sizeof(magic) && memcmp(data, &magic, sizeof(magic)) == 0;
+}
+
+qmsd_ota_delta_t* qmsd_ota_delta_create(qmsd_ota_delta_output_t output, void* ctx) {
+    qmsd_ota_delta_t* delta = heap_caps_calloc(1, sizeof(qmsd_ota_delta_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (delta == NULL) {
+        return NULL;
+    }
+    delta->output = output;
+    delta->ctx = ctx;
+    delta->src = esp_ota_get_running_partition();
+    delta->state = DELTA_STATE_HEADER;
+    delta->need = sizeof(qmsd_ota_delta_header_t);
+    mbedtls_sha256_init(&delta->sha);
+    mbedtls_sha256_starts(&delta->sha, 0);
+    return delta;
+}
+
+static esp_err_t delta_emit(qmsd_ota_delta_t* delta, const uint8_t* data, uint32_t len) {
+    if (len > delta->header.dst_size - delta->out_size) {
+        ESP_LOGE(TAG, "output exceeds %lu", delta->header.dst_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    delta->out_size += len;
+    mbedtls_sha256_update(&delta->sha, data, len);
+    return delta->output(delta->ctx, data, len);
+}
+
+// 读取运行分区到窗口
+static esp_err_t delta_read_src(qmsd_ota_delta_t* delta, uint32_t len) {
+    esp_err_t err = esp_partition_read(delta->src, delta->src_offset, delta->window, len);
+    delta->src_offset += len;
+    return err;
+}
+
+static esp_err_t delta_header_done(qmsd_ota_delta_t* delta) {
+    qmsd_ota_delta_header_t* header = &delta->header;
+    if (header->magic != QMSD_OTA_DELTA_MAGIC || header->version != QMSD_OTA_DELTA_VERSION) {
+        ESP_LOGE(TAG, "unsupported delta, version: %d", header->version);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (delta->src == NULL || header->src_size > delta->src->size ||
+        memcmp(header->src_elf_sha256, esp_app_get_description()->app_elf_sha256, sizeof(header->src_elf_sha256)) != 0) {
+        ESP_LOGE(TAG, "delta is not based on running firmware");
+        return ESP_ERR_INVALID_VERSION;
+    }
+    ESP_LOGI(TAG, "apply delta %lu -> %lu from %s", header->src_size, header->dst_size, delta->src->label);
+    delta->state = DELTA_STATE_OP;
+    return ESP_OK;
+}
+
+static esp_err_t delta_args_done(qmsd_ota_delta_t* delta) {
+    uint32_t value[2];
+    memcpy(value, delta->args, sizeof(value));
+    if (delta->op == QMSD_OTA_DELTA_OP_INSERT) {
+        delta->remain = value[0];
+    } else {
+        delta->src_offset = value[0];
+        delta->remain = value[1];
+        if (delta->src_offset > delta->header.src_size || delta->remain > delta->header.src_size - delta->src_offset) {
+            ESP_LOGE(TAG, "source out of range: %lu + %lu", delta->src_offset, delta->remain);
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    delta->state = delta->remain ? DELTA_STATE_DATA : DELTA_STATE_OP;
+    if (delta->op != QMSD_OTA_DELTA_OP_COPY) {
+        return ESP_OK;
+    }
+
+    // COPY 不带数据，直接按窗口从运行分区拷贝
+    esp_err_t err = ESP_OK;
+    while (delta->remain > 0 && err == ESP_OK) {
+        uint32_t n = delta->remain < QMSD_OTA_DELTA_WINDOW_SIZE ? delta->remain : QMSD_OTA_DELTA_WINDOW_SIZE;
+        err = delta_read_src(delta, n);
+        if (err == ESP_OK) {
+            err = delta_emit(delta, delta->window, n);
+        }
+        delta->remain -= n;
+    }
+    delta->state = DELTA_STATE_OP;
+    return err;
+}
+
+esp_err_t qmsd_ota_delta_feed(qmsd_ota_delta_t* delta, const uint8_t* data, uint32_t len) {
+    esp_err_t err = ESP_OK;
+    while (len > 0 && err == ESP_OK) {
+        uint32_t n;
+        switch (delta->state) {
+            case DELTA_STATE_HEADER:
+            case DELTA_STATE_ARGS: {
+                uint8_t* dst = delta->state == DELTA_STATE_HEADER ? (uint8_t*)&delta->header : delta->args;
+                n = delta->need - delta->fill < len ? delta->need - delta->fill : len;
+                memcpy(dst + delta->fill, data, n);
+                delta->fill += n;
+                if (delta->fill == delta->need) {
+                    err = delta->state == DELTA_STATE_HEADER ? delta_header_done(delta) : delta_args_done(delta);
+                }
+                break;
+            }
+            case DELTA_STATE_OP:
+                n = 1;
+                delta->op = data[0];
+                delta->fill = 0;
+                if (delta->op == QMSD_OTA_DELTA_OP_END) {
+                    delta->state = DELTA_STATE_DONE;
+                } else if (delta->op == QMSD_OTA_DELTA_OP_COPY || delta->op == QMSD_OTA_DELTA_OP_ADD) {
+                    delta->need = 8;
+                    delta->state = DELTA_STATE_ARGS;
+                } else if (delta->op == QMSD_OTA_DELTA_OP_INSERT) {
+                    delta->need = 4;
+                    delta->state = DELTA_STATE_ARGS;
+                } else {
+                    ESP_LOGE(TAG, "unknown op: %d", delta->op);
+                    err = ESP_ERR_INVALID_ARG;
+                }
+                break;
+            case DELTA_STATE_DATA:
+                n = delta->remain < len ? delta->remain : len;
+                if (delta->op == QMSD_OTA_DELTA_OP_INSERT) {
+                    err = delta_emit(delta, data, n);
+                } else {
+                    n = n < QMSD_OTA_DELTA_WINDOW_SIZE ? n : QMSD_OTA_DELTA_WINDOW_SIZE;
+                    err = delta_read_src(delta, n);
+                    for (uint32_t i = 0; i < n && err == ESP_OK; i++) {
+                        delta->window[i] += data[i];
+                    }
+                    if (err == ESP_OK) {
+                        err = delta_emit(delta, delta->window, n);
+                    }
+                }
+                delta->remain -= n;
+                if (delta->remain == 0) {
+                    delta->state = DELTA_STATE_OP;
+                }
+                break;
+            default:
+                ESP_LOGE(TAG, "data after end");
+                return ESP_ERR_INVALID_ARG;
+        }
+        data += n;
+        len -= n;
+    }
+    return err;
+}
+
+esp_err_t qmsd_ota_delta_finish(qmsd_ota_delta_t* delta) {
+    if (delta->state != DELTA_STATE_DONE || delta->out_size != delta->header.dst_size) {
+        ESP_LOGE(TAG, "delta incomplete, output %lu / %lu", delta->out_size, delta->header.dst_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t sha256[32];
+    mbedtls_sha256_finish(&delta->sha, sha256);
+    if (memcmp(sha256, delta->header.dst_sha256, sizeof(sha256)) != 0) {
+        ESP_LOGE(TAG, "new image sha256 mismatch");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+void qmsd_ota_delta_destroy(qmsd_ota_delta_t* delta) {
+    if (delta == NULL) {
+        return;
+    }
+    mbedtls_sha256_free(&delta->sha);
+    heap_caps_free(delta);
+}
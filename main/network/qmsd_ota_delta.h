@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 差分包魔数 "QDLT"，与 main/tools/mkdelta.py 保持一致 */
+#define QMSD_OTA_DELTA_MAGIC 0x544c4451
+#define QMSD_OTA_DELTA_VERSION 1
+/** @brief 读取运行分区的窗口大小，COPY/ADD 按窗口分段处理 */
+#define QMSD_OTA_DELTA_WINDOW_SIZE 1024
+
+/**
+ * 差分包格式(小端):
+ *   头部: magic(u32) | version(u16) | reserved(u16) | src_size(u32) | dst_size(u32) |
+ *         src_elf_sha256(32) | dst_sha256(32)
+ *   操作: type(u8) + 参数，依次生成新镜像
+ *         COPY   src_offset(u32) | len(u32)            从运行分区拷贝
+ *         ADD    src_offset(u32) | len(u32) | diff[len] 运行分区数据逐字节加 diff
+ *         INSERT len(u32) | data[len]                  新数据
+ *         END
+ */
+typedef enum {
+    QMSD_OTA_DELTA_OP_END = 0,
+    QMSD_OTA_DELTA_OP_COPY = 1,
+    QMSD_OTA_DELTA_OP_ADD = 2,
+    QMSD_OTA_DELTA_OP_INSERT = 3,
+} qmsd_ota_delta_op_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t src_size;           // 旧镜像长度
+    uint32_t dst_size;           // 新镜像长度
+    uint8_t src_elf_sha256[32];  // 旧镜像 app 描述中的 elf sha256，必须与运行中的固件一致
+    uint8_t dst_sha256[32];      // 完整新镜像的 sha256
+} qmsd_ota_delta_header_t;
+
+/**
+ * @brief 新镜像数据输出回调，按顺序输出
+ * @return ESP_OK 继续，其他值中止
+ */
+typedef esp_err_t (*qmsd_ota_delta_output_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+typedef struct qmsd_ota_delta qmsd_ota_delta_t;
+
+/**
+ * @brief 判断数据是否为差分包
+ * @param data 下载的第一段数据
+ * @param len 数据长度
+ * @return true 以差分包魔数开头
+ */
+bool qmsd_ota_delta_check(const uint8_t* data, uint32_t len);
+
+/**
+ * @brief 创建差分包解析器，源数据为当前运行分区
+ * @param output 新镜像数据输出回调
+ * @param ctx 回调参数
+ * @return 解析器，内存不足返回 NULL
+ */
+qmsd_ota_delta_t* qmsd_ota_delta_create(qmsd_ota_delta_output_t output, void* ctx);
+
+/**
+ * @brief 输入差分包数据
+ * @param delta 解析器
+ * @param data 差分包数据，可以按任意长度分段输入
+ * @param len 数据长度
+ * @return ESP_OK 成功，ESP_ERR_INVALID_VERSION 差分包不是基于当前运行的固件，ESP_ERR_INVALID_ARG 差分包格式错误
+ * @note 只使用 QMSD_OTA_DELTA_WINDOW_SIZE 大小的窗口，INSERT 数据直接透传，不缓存整段
+ */
+esp_err_t qmsd_ota_delta_feed(qmsd_ota_delta_t* delta, const uint8_t* data, uint32_t len);
+
+/**
+ * @brief 差分包输入完成，校验新镜像
+ * @param delta 解析器
+ * @return ESP_OK 已解析到 END 且新镜像长度和 sha256 与头部一致
+ */
+esp_err_t qmsd_ota_delta_finish(qmsd_ota_delta_t* delta);
+
+/**
+ * @brief 释放解析器
+ * @param delta 解析器
+ */
+void qmsd_ota_delta_destroy(qmsd_ota_delta_t* delta);
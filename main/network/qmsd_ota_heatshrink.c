@@ -0,0 +1,200 @@
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "mbedtls/sha256.h"
+#include "qmsd_ota_heatshrink.h"
+
+#define TAG "qmsd_ota_hs"
+
+typedef enum {
+    HS_STATE_HEADER = 0,
+    HS_STATE_TAG,
+    HS_STATE_LITERAL,
+    HS_STATE_INDEX,
+    HS_STATE_COUNT,
+} hs_state_t;
+
+struct qmsd_ota_heatshrink {
+    qmsd_ota_heatshrink_output_t output;
+    void* ctx;
+    qmsd_ota_heatshrink_header_t header;
+    uint8_t header_fill;
+    hs_state_t state;
+    uint32_t bits;       // 未处理的位，低 bit_count 位有效
+    uint8_t bit_count;
+    uint16_t distance;   // 当前回溯距离
+    uint8_t* window;     // 环形窗口，同时作为输出缓冲
+    uint32_t mask;
+    uint32_t pos;        // 已解压长度
+    uint32_t flushed;    // 已输出长度
+    esp_err_t err;
+    mbedtls_sha256_context sha;
+};
+
+bool qmsd_ota_heatshrink_check(const uint8_t* data, uint32_t len) {
+    uint32_t magic = QMSD_OTA_HEATSHRINK_MAGIC;
+    return len >= sizeof(magic) && memcmp(data, &magic, sizeof(magic)) == 0;
+}
+
+qmsd_ota_heatshrink_t* qmsd_ota_heatshrink_create(qmsd_ota_heatshrink_output_t output, void* ctx) {
+    qmsd_ota_heatshrink_t* hs = heap_caps_calloc(1, sizeof(qmsd_ota_heatshrink_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (hs == NULL) {
+        return NULL;
+    }
+    hs->output = output;
+    hs->ctx = ctx;
+    hs->state = HS_STATE_HEADER;
+    mbedtls_sha256_init(&hs->sha);
+    mbedtls_sha256_starts(&hs->sha, 0);
+    return hs;
+}
+
+// 输出窗口中还没有输出的部分
+static void hs_flush(qmsd_ota_heatshrink_t* hs) {
+    uint32_t len = hs->pos - hs->flushed;
+    if (len == 0 || hs->err != ESP_OK) {
+        return;
+    }
+    const uint8_t* data = hs->window + (hs->flushed & hs->mask);
+    mbedtls_sha256_update(&hs->sha, data, len);
+    hs->err = hs->output(hs->ctx, data, len);
+    hs->flushed = hs->pos;
+}
+
+static void hs_put(qmsd_ota_heatshrink_t* hs, uint8_t c) {
+    hs->window[hs->pos & hs->mask] = c;
+    hs->pos += 1;
+    // 写到窗口末尾时输出，下一圈覆盖之前必须输出
+    if ((hs->pos & hs->mask) == 0) {
+        hs_flush(hs);
+    }
+}
+
+static esp_err_t hs_header_done(qmsd_ota_heatshrink_t* hs) {
+    qmsd_ota_heatshrink_header_t* header = &hs->header;
+    if (header->magic != QMSD_OTA_HEATSHRINK_MAGIC || header->version != QMSD_OTA_HEATSHRINK_VERSION ||
+        header->window_bits < 4 || header->window_bits > QMSD_OTA_HEATSHRINK_WINDOW_BITS_MAX ||
+        header->lookahead_bits < 3 || header->lookahead_bits >= header->window_bits) {
+        ESP_LOGE(TAG, "unsupported image, version: %d, window: %d, lookahead: %d", header->version, header->window_bits,
+                 header->lookahead_bits);
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 初始窗口为 0，与 heatshrink 编码器一致
+    hs->window = heap_caps_calloc(1, 1 << header->window_bits, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (hs->window == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    hs->mask = (1 << header->window_bits) - 1;
+    hs->state = HS_STATE_TAG;
+    ESP_LOGI(TAG, "compressed image, raw size: %lu, window: %d", header->raw_size, 1 << header->window_bits);
+    return ESP_OK;
+}
+
+// 从位缓冲取 count 位，不够时返回 false
+static bool hs_get_bits(qmsd_ota_heatshrink_t* hs, uint8_t count, uint16_t* value) {
+    if (hs->bit_count < count) {
+        return false;
+    }
+    hs->bit_count -= count;
+    *value = (hs->bits >> hs->bit_count) & ((1 << count) - 1);
+    return true;
+}
+
+// 尽可能解码位缓冲中的数据
+static esp_err_t hs_decode(qmsd_ota_heatshrink_t* hs) {
+    qmsd_ota_heatshrink_header_t* header = &hs->header;
+    uint16_t value;
+    while (hs->err == ESP_OK && hs->pos < header->raw_size) {
+        if (hs->state == HS_STATE_TAG) {
+            if (!hs_get_bits(hs, 1, &value)) {
+                break;
+            }
+            hs->state = value ? HS_STATE_LITERAL : HS_STATE_INDEX;
+        } else if (hs->state == HS_STATE_LITERAL) {
+            if (!hs_get_bits(hs, 8, &value)) {
+                break;
+            }
+            hs_put(hs, value);
+            hs->state = HS_STATE_TAG;
+        } else if (hs->state == HS_STATE_INDEX) {
+            if (!hs_get_bits(hs, header->window_bits, &value)) {
+                break;
+            }
+            hs->distance = value + 1;
+            hs->state = HS_STATE_COUNT;
+        } else {
+            if (!hs_get_bits(hs, header->lookahead_bits, &value)) {
+                break;
+            }
+            uint32_t count = value + 1;
+            if (count > header->raw_size - hs->pos) {
+                ESP_LOGE(TAG, "backref exceeds raw size at %lu", hs->pos);
+                return ESP_ERR_INVALID_ARG;
+            }
+            for (uint32_t i = 0; i < count; i++) {
+                hs_put(hs, hs->window[(hs->pos - hs->distance) & hs->mask]);
+            }
+            hs->state = HS_STATE_TAG;
+        }
+    }
+    return hs->err;
+}
+
+esp_err_t qmsd_ota_heatshrink_feed(qmsd_ota_heatshrink_t* hs, const uint8_t* data, uint32_t len) {
+    if (hs->state == HS_STATE_HEADER) {
+        uint32_t n = sizeof(qmsd_ota_heatshrink_header_t) - hs->header_fill;
+        n = n < len ? n : len;
+        memcpy((uint8_t*)&hs->header + hs->header_fill, data, n);
+        hs->header_fill += n;
+        data += n;
+        len -= n;
+        if (hs->header_fill < sizeof(qmsd_ota_heatshrink_header_t)) {
+            return ESP_OK;
+        }
+        esp_err_t err = hs_header_done(hs);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        if (hs->pos >= hs->header.raw_size) {
+            // 最后一个字节中的填充位之后不应该还有数据
+            ESP_LOGE(TAG, "data after end");
+            return ESP_ERR_INVALID_ARG;
+        }
+        hs->bits = (hs->bits << 8) | data[i];
+        hs->bit_count += 8;
+        esp_err_t err = hs_decode(hs);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    hs_flush(hs);
+    return hs->err;
+}
+
+esp_err_t qmsd_ota_heatshrink_finish(qmsd_ota_heatshrink_t* hs) {
+    if (hs->state == HS_STATE_HEADER || hs->pos != hs->header.raw_size) {
+        ESP_LOGE(TAG, "image incomplete, raw %lu / %lu", hs->pos, hs->header.raw_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t sha256[32];
+    mbedtls_sha256_finish(&hs->sha, sha256);
+    if (memcmp(sha256, hs->header.raw_sha256, sizeof(sha256)) != 0) {
+        ESP_LOGE(TAG, "raw sha256 mismatch");
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    return ESP_OK;
+}
+
+void qmsd_ota_heatshrink_destroy(qmsd_ota_heatshrink_t* hs) {
+    if (hs == NULL) {
+        return;
+    }
+    mbedtls_sha256_free(&hs->sha);
+    heap_caps_free(hs->window);
+    heap_caps_free(hs);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/** @brief 压缩包魔数 "QHSZ"，与 main/tools/mkcompress.py 保持一致 */
+#define QMSD_OTA_HEATSHRINK_MAGIC 0x5a534851
+#define QMSD_OTA_HEATSHRINK_VERSION 1
+/** @brief 支持的最大窗口，窗口为 2^window_bits 字节，解压只需要这一块内存 */
+#define QMSD_OTA_HEATSHRINK_WINDOW_BITS_MAX 12
+
+/**
+ * 压缩包格式(小端):
+ *   头部: magic(u32) | version(u8) | window_bits(u8) | lookahead_bits(u8) | reserved(u8) |
+ *         raw_size(u32) | raw_sha256(32)
+ *   数据: heatshrink 位流(高位在前)，与 heatshrink -w <window_bits> -l <lookahead_bits> 的输出相同
+ *         1 + 8 位字面量，或 0 + window_bits 位距离(减 1) + lookahead_bits 位长度(减 1)
+ * 解压后的内容可以是完整镜像，也可以是差分包
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t reserved;
+    uint32_t raw_size;       // 解压后长度
+    uint8_t raw_sha256[32];  // 解压后数据的 sha256
+} qmsd_ota_heatshrink_header_t;
+
+/**
+ * @brief 解压数据输出回调，按顺序输出
+ * @return ESP_OK 继续，其他值中止
+ */
+typedef esp_err_t (*qmsd_ota_heatshrink_output_t)(void* ctx, const uint8_t* data, uint32_t len);
+
+typedef struct qmsd_ota_heatshrink qmsd_ota_heatshrink_t;
+
+/**
+ * @brief 判断数据是否为压缩包
+ * @param data 下载的第一段数据
+ * @param len 数据长度
+ * @return true 以压缩包魔数开头
+ */
+bool qmsd_ota_heatshrink_check(const uint8_t* data, uint32_t len);
+
+/**
+ * @brief 创建解压器
+ * @param output 解压数据输出回调
+ * @param ctx 回调参数
+ * @return 解压器，内存不足返回 NULL
+ * @note 窗口在收到头部后按 window_bits 分配
+ */
+qmsd_ota_heatshrink_t* qmsd_ota_heatshrink_create(qmsd_ota_heatshrink_output_t output, void* ctx);
+
+/**
+ * @brief 输入压缩数据
+ * @param hs 解压器
+ * @param data 压缩数据，可以按任意长度分段输入
+ * @param len 数据长度
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 格式错误或超过 raw_size，ESP_ERR_NO_MEM 窗口分配失败
+ * @note 解压结果直接在窗口中生成，窗口写满一圈或本次输入处理完时输出，不另外缓存
+ */
+esp_err_t qmsd_ota_heatshrink_feed(qmsd_ota_heatshrink_t* hs, const uint8_t* data, uint32_t len);
+
+/**
+ * @brief 压缩数据输入完成，校验解压结果
+ * @param hs 解压器
+ * @return ESP_OK 解压长度和 sha256 与头部一致
+ */
+esp_err_t qmsd_ota_heatshrink_finish(qmsd_ota_heatshrink_t* hs);
+
+/**
+ * @brief 释放解压器
+ * @param hs 解压器
+ */
+void qmsd_ota_heatshrink_destroy(qmsd_ota_heatshrink_t* hs);
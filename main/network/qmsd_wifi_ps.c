@@ -0,0 +1,74 @@
+#include "aiha_websocket.h"
+#include "audio_player_user.h"
+#include "esp_log.h"
+#include "esp_wifi.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "gx8006.h"
+#include "qmsd_ota.h"
+#include "qmsd_utils.h"
+#include "qmsd_wifi_ps.h"
+
+#define TAG "qmsd.ps"
+
+// 一轮对话进行中的状态，完成、出错、退出后按空闲处理
+#define WIFI_PS_CHAT_BUSY                                                                                          \
+    (ALLINONE_STATUS_AUDIO_START | ALLINONE_STATUS_AUDIO_FINISH | ALLINONE_STATUS_ASR_VALID |                     \
+     ALLINONE_STATUS_ASR_FINISH | ALLINONE_STATUS_ANSWER_TEXT_VALID | ALLINONE_STATUS_ANSWER_MP3_VALID)
+
+static SemaphoreHandle_t ps_lock;
+static wifi_ps_type_t ps_mode = WIFI_PS_MIN_MODEM;  // esp_wifi 默认模式
+static TickType_t busy_ticks;
+
+// 需要持有 ps_lock
+static void wifi_ps_set(wifi_ps_type_t mode) {
+    if (ps_mode == mode) {
+        return;
+    }
+    esp_err_t err = esp_wifi_set_ps(mode);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "set ps %d failed: %s", mode, esp_err_to_name(err));
+        return;
+    }
+    ps_mode = mode;
+    ESP_LOGI(TAG, "power save: %s", mode == WIFI_PS_NONE ? "none" : "max modem");
+}
+
+static bool wifi_ps_busy(void) {
+    return gx8006_in_wakeup() || audio_player_in_running() || aiha_websocket_is_music_playing() ||
+           (aiha_websocket_get_status() & WIFI_PS_CHAT_BUSY) || qmsd_ota_in_progress();
+}
+
+static void wifi_ps_task(void* arg) {
+    for (;;) {
+        xSemaphoreTake(ps_lock, portMAX_DELAY);
+        if (wifi_ps_busy()) {
+            busy_ticks = xTaskGetTickCount();
+            wifi_ps_set(WIFI_PS_NONE);
+        } else if (xTaskGetTickCount() - busy_ticks > pdMS_TO_TICKS(QMSD_WIFI_PS_IDLE_MS)) {
+            wifi_ps_set(WIFI_PS_MAX_MODEM);
+        }
+        xSemaphoreGive(ps_lock);
+        vTaskDelay(pdMS_TO_TICKS(QMSD_WIFI_PS_CHECK_MS));
+    }
+}
+
+void qmsd_wifi_ps_start(void) {
+    if (ps_lock) {
+        return;
+    }
+    ps_lock = xSemaphoreCreateMutex();
+    busy_ticks = xTaskGetTickCount();
+    qmsd_thread_create(wifi_ps_task, "wifi_ps_task", 2 * 1024, NULL, 3, NULL, 0, 0);
+}
+
+void qmsd_wifi_ps_active(void) {
+    if (ps_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(ps_lock, portMAX_DELAY);
+    busy_ticks = xTaskGetTickCount();
+    wifi_ps_set(WIFI_PS_NONE);
+    xSemaphoreGive(ps_lock);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+/** @brief 空闲时的监听间隔(beacon 个数)，连接时生效，只在 WIFI_PS_MAX_MODEM 下使用 */
+#define QMSD_WIFI_PS_LISTEN_INTERVAL 10
+/** @brief 对话、播放等全部结束后保持不省电的时间(ms)，避免连续对话反复切换 */
+#define QMSD_WIFI_PS_IDLE_MS 5000
+/** @brief 状态检查周期(ms) */
+#define QMSD_WIFI_PS_CHECK_MS 100
+
+/**
+ * @brief 启动 Wi-Fi 省电策略
+ * @note 联网后调用，可重复调用。空闲时使用 WIFI_PS_MAX_MODEM 按 QMSD_WIFI_PS_LISTEN_INTERVAL 监听，
+ *       唤醒、对话、播放、OTA 下载期间关闭省电，避免下行数据等待 DTIM 带来的 100ms 以上延迟
+ */
+void qmsd_wifi_ps_start(void);
+
+/**
+ * @brief 立即关闭省电
+ * @note 在唤醒回调中最先调用，保证第一个上行包发出前已经退出省电，之后由策略任务在空闲后恢复
+ */
+void qmsd_wifi_ps_active(void);
@@ -0,0 +1,83 @@
+/**
+ * chat_number_parse 主机端语料测试，只依赖 cmd_match.h，不需要 ESP-IDF
+ * 文本中有"音量"或"声音"时从关键词之后解析，和 chat_cmd 的调用方式一致
+ *
+ * 用法(在 main/test 目录):
+ *     make
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chat_number.h"
+
+#define LINE_MAX_SIZE 256
+
+// 和音量命令一样的关键词；方向词用"大声/小声"，覆盖注册方向词的处理
+static const char* const test_keywords[] = { "音量", "声音" };
+#define TEST_DIR_UP "大声|响亮"
+#define TEST_DIR_DOWN "小声"
+
+// 从文本中第一个关键词之后开始解析，没有关键词时解析整个文本
+static bool parse_line(const char* text, command_result_t* result) {
+    const char* keyword_pos = NULL;
+    uint32_t keyword_len = 0;
+    for (int i = 0; i < sizeof(test_keywords) / sizeof(test_keywords[0]); i++) {
+        const char* pos = strstr(text, test_keywords[i]);
+        if (pos && (keyword_pos == NULL || pos < keyword_pos)) {
+            keyword_pos = pos;
+            keyword_len = strlen(test_keywords[i]);
+        }
+    }
+    uint32_t start = keyword_pos ? keyword_pos - text : 0;
+    return chat_number_parse(text, start, start + keyword_len, TEST_DIR_UP, TEST_DIR_DOWN, result);
+}
+
+static bool check_line(const char* text, const char* expect) {
+    command_result_t result = { 0 };
+    bool ok = parse_line(text, &result);
+    if (strcmp(expect, "none") == 0) {
+        return ok == false;
+    }
+
+    char kind[16];
+    float value;
+    if (sscanf(expect, "%15s %f", kind, &value) != 2) {
+        printf("bad expect: %s\n", expect);
+        return false;
+    }
+    command_dir_t dir = strcmp(kind, "modify") == 0 ? CMD_DIR_VALUE_MODIFY : CMD_DIR_VALUE_EXACT;
+    return ok && result.result == CMD_MATCH_VALUE_OR_DIR && result.dir == dir && result.value == value;
+}
+
+int main(int argc, char** argv) {
+    const char* corpus = argc > 1 ? argv[1] : "chat_number_corpus.txt";
+    FILE* fp = fopen(corpus, "r");
+    if (fp == NULL) {
+        printf("open %s failed\n", corpus);
+        return 1;
+    }
+
+    char line[LINE_MAX_SIZE];
+    int total = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        char* tab = strchr(line, '\t');
+        if (line[0] == '#' || tab == NULL) {
+            continue;
+        }
+        *tab = '\0';
+        total += 1;
+        if (check_line(line, tab + 1) == false) {
+            command_result_t result = { 0 };
+            parse_line(line, &result);
+            printf("FAIL %s: expect %s, got result %d dir %d value %g\n", line, tab + 1, result.result, result.dir,
+                   result.value);
+            failed += 1;
+        }
+    }
+    fclose(fp);
+    printf("%d/%d passed\n", total - failed, total);
+    return failed ? 1 : 0;
+}
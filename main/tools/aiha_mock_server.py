@@ -0,0 +1,459 @@
+"""
+AIHA 云端协议本地替身服务器, 用于在 Linux 上离线复现对话链路的延迟/吞吐测试.
+
+覆盖 aiha_websocket.h / aiha_audio_http.h / aiha_req_ota.h 用到的接口:
+  ws://<pid>.llm.aiha.cloud:8099/ws/chat            对话 websocket (hello, opus 上行, asr 文本, mp3/opus 下行)
+  POST http://<pid>.llm.aiha.cloud:8099/dsse/tts/template   TTS 请求, 返回音频 URL
+  POST http://admin.8ms.xyz/iot/ota/checkUpdate     OTA 检查, 返回固件 URL
+  GET  /media/<name>, /firmware/<name>              音频/固件下载, 支持 Range
+
+libaiha_server.a 中的域名是写死的, 测试时需要把 *.llm.aiha.cloud 和 admin.8ms.xyz
+解析到本机 (例如 dnsmasq: address=/llm.aiha.cloud/192.168.1.10 address=/admin.8ms.xyz/192.168.1.10).
+
+消息的字段名取自客户端库 (type, hashCode, volumeDb, asrResult, asrFinish, ttsStart,
+audioData, audioFinish, resultCode, resultMsg), 具体的 JSON 结构集中在 MESSAGES 中,
+和云端对不上时只需要改这里.
+
+只依赖 python3 标准库:
+  python3 aiha_mock_server.py --audio-dir ../tone_res --asr-text "今天天气怎么样" \
+      --asr-delay-ms 300 --first-audio-delay-ms 500 --jitter-ms 30 --loss 0.01
+  python3 aiha_mock_server.py --script scenario.json     # 按轮次指定 asr 文本/延迟/音频
+"""
+
+import argparse
+import asyncio
+import base64
+import hashlib
+import json
+import os
+import random
+import struct
+import time
+
+from urllib.parse import urlsplit
+
+WS_GUID = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+OP_CONT = 0x0
+OP_TEXT = 0x1
+OP_BINARY = 0x2
+OP_CLOSE = 0x8
+OP_PING = 0x9
+OP_PONG = 0xA
+
+# 下发给设备的消息模板, 与 aiha_websocket.c 中解析的字段对应
+MESSAGES = {
+    "tts_config": lambda hashcode, volume_db: {"type": "ttsConfig", "hashCode": hashcode, "volumeDb": volume_db},
+    "asr": lambda text, finish: {"type": "asrResult", "asrResult": text, "asrFinish": finish},
+    "answer": lambda text: {"type": "answer", "content": text},
+    "tts_start": lambda codec: {"type": "ttsStart", "ttsCodec": codec},
+    "audio_finish": lambda: {"type": "audioFinish"},
+    "error": lambda code, msg: {"resultCode": code, "resultMsg": msg},
+}
+
+# 设备上行的 json 中, 表示一轮录音开始/结束的字段
+UPLINK_START_KEYS = ("audio_start", "audioStart", "start")
+UPLINK_FINISH_KEYS = ("audio_finish", "audioFinish", "finish", "end")
+
+
+def log(fmt, *args):
+    print(time.strftime("%H:%M:%S") + " " + (fmt % args if args else fmt), flush=True)
+
+
+class Scenario:
+    """每一轮对话的响应参数, 命令行给默认值, --script 按轮次覆盖"""
+
+    def __init__(self, args):
+        self.args = args
+        self.turns = []
+        if args.script:
+            with open(args.script, "r", encoding="utf-8") as f:
+                self.turns = json.load(f).get("turns", [])
+
+    def turn(self, index):
+        base = {
+            "asr_text": self.args.asr_text,
+            "answer": self.args.answer,
+            "asr_delay_ms": self.args.asr_delay_ms,
+            "first_audio_delay_ms": self.args.first_audio_delay_ms,
+            "audio": self.args.reply_audio,
+            "codec": self.args.codec,
+            "error_code": 0,
+        }
+        if self.turns:
+            base.update(self.turns[index % len(self.turns)])
+        return base
+
+    def delay(self, ms):
+        jitter = random.uniform(-self.args.jitter_ms, self.args.jitter_ms) if self.args.jitter_ms else 0
+        return max(0.0, (ms + jitter) / 1000.0)
+
+    def lost(self):
+        return self.args.loss > 0 and random.random() < self.args.loss
+
+
+def parse_range(range_header, size):
+    """解析单个 Range 区间 (bytes=N-M / bytes=N- / bytes=-N).
+
+    返回 (start, end) 闭区间; 没有 Range 或格式不支持时返回 None, 按整个文件回复;
+    起点超出文件或后缀长度为 0 时返回 "unsatisfiable", 需要回复 416.
+    """
+    if not range_header.startswith("bytes=") or "," in range_header:
+        return None
+    start, sep, end = range_header[6:].strip().partition("-")
+    if not sep or not (start or end) or not (start or "0").isdigit() or not (end or "0").isdigit():
+        return None
+    if not start:
+        # 后缀区间: 最后 N 字节, 超过文件长度时返回整个文件
+        length = int(end)
+        if length == 0 or size == 0:
+            return "unsatisfiable"
+        return max(size - length, 0), size - 1
+    start = int(start)
+    if end and int(end) < start:
+        # 终点小于起点的区间无效, 按 RFC 7233 忽略 Range
+        return None
+    if start >= size:
+        return "unsatisfiable"
+    end = min(int(end), size - 1) if end else size - 1
+    return start, end
+
+
+def iter_mp3_chunks(data, chunk_size):
+    for i in range(0, len(data), chunk_size):
+        yield data[i:i + chunk_size]
+
+
+def iter_opus_packets(data):
+    """opus 下行文件格式: 每包 2 字节大端长度 + 数据, 与客户端的 opus 拆包逻辑对应"""
+    pos = 0
+    while pos + 2 <= len(data):
+        (length,) = struct.unpack(">H", data[pos:pos + 2])
+        yield data[pos:pos + 2 + length]
+        pos += 2 + length
+
+
+class WebSocket:
+    def __init__(self, reader, writer):
+        self.reader = reader
+        self.writer = writer
+        self.lock = asyncio.Lock()
+
+    async def recv(self):
+        """返回 (opcode, payload), 连接关闭返回 (OP_CLOSE, b'')"""
+        message = bytearray()
+        message_op = None
+        while True:
+            try:
+                head = await self.reader.readexactly(2)
+            except (asyncio.IncompleteReadError, ConnectionError):
+                return OP_CLOSE, b""
+            fin = head[0] & 0x80
+            opcode = head[0] & 0x0F
+            length = head[1] & 0x7F
+            masked = head[1] & 0x80
+            if length == 126:
+                (length,) = struct.unpack(">H", await self.reader.readexactly(2))
+            elif length == 127:
+                (length,) = struct.unpack(">Q", await self.reader.readexactly(8))
+            mask = await self.reader.readexactly(4) if masked else b"\0\0\0\0"
+            payload = bytearray(await self.reader.readexactly(length))
+            for i in range(length):
+                payload[i] ^= mask[i % 4]
+
+            if opcode == OP_PING:
+                await self.send(OP_PONG, bytes(payload))
+                continue
+            if opcode == OP_PONG:
+                continue
+            if opcode == OP_CLOSE:
+                return OP_CLOSE, bytes(payload)
+            if opcode != OP_CONT:
+                message_op = opcode
+            message += payload
+            if fin:
+                return message_op, bytes(message)
+
+    async def send(self, opcode, payload):
+        if isinstance(payload, str):
+            payload = payload.encode("utf-8")
+        head = bytes([0x80 | opcode])
+        length = len(payload)
+        if length < 126:
+            head += bytes([length])
+        elif length < 0x10000:
+            head += bytes([126]) + struct.pack(">H", length)
+        else:
+            head += bytes([127]) + struct.pack(">Q", length)
+        async with self.lock:
+            self.writer.write(head + payload)
+            await self.writer.drain()
+
+    async def send_json(self, obj):
+        await self.send(OP_TEXT, json.dumps(obj, ensure_ascii=False))
+
+
+class ChatSession:
+    def __init__(self, ws, scenario, audio_dir):
+        self.ws = ws
+        self.scenario = scenario
+        self.audio_dir = audio_dir
+        self.turn_index = 0
+        self.uplink_bytes = 0
+        self.uplink_packets = 0
+        self.turn_start = 0.0
+        self.reply_task = None
+
+    async def run(self):
+        args = self.scenario.args
+        while True:
+            opcode, payload = await self.ws.recv()
+            if opcode == OP_CLOSE:
+                break
+            if opcode == OP_BINARY:
+                if self.uplink_packets == 0:
+                    self.turn_start = time.monotonic()
+                self.uplink_packets += 1
+                self.uplink_bytes += len(payload)
+                continue
+
+            try:
+                msg = json.loads(payload.decode("utf-8"))
+            except ValueError:
+                log("ws text (not json): %s", payload[:80])
+                continue
+            log("ws recv: %s", json.dumps(msg, ensure_ascii=False)[:200])
+
+            if "deviceId" in msg or msg.get("type") == "hello":
+                await self.ws.send_json(MESSAGES["tts_config"](args.hashcode, args.volume_db))
+            elif any(key in msg for key in UPLINK_START_KEYS) or msg.get("type") in UPLINK_START_KEYS:
+                self.cancel_reply()
+                self.uplink_bytes = 0
+                self.uplink_packets = 0
+                self.turn_start = time.monotonic()
+            elif any(key in msg for key in UPLINK_FINISH_KEYS) or msg.get("type") in UPLINK_FINISH_KEYS:
+                self.cancel_reply()
+                self.reply_task = asyncio.ensure_future(self.reply(self.turn_index, self.scenario.turn(self.turn_index)))
+                self.turn_index += 1
+            elif msg.get("type") in ("stop", "stopAll", "abort"):
+                self.cancel_reply()
+
+    def cancel_reply(self):
+        if self.reply_task and not self.reply_task.done():
+            self.reply_task.cancel()
+        self.reply_task = None
+
+    async def reply(self, index, turn):
+        log("turn %d: uplink %d packets / %d bytes in %.0f ms", index, self.uplink_packets,
+            self.uplink_bytes, (time.monotonic() - self.turn_start) * 1000)
+
+        await asyncio.sleep(self.scenario.delay(turn["asr_delay_ms"]))
+        if turn["error_code"]:
+            await self.ws.send_json(MESSAGES["error"](turn["error_code"], "mock error"))
+            return
+        await self.ws.send_json(MESSAGES["asr"](turn["asr_text"], True))
+        if turn["answer"]:
+            await self.ws.send_json(MESSAGES["answer"](turn["answer"]))
+
+        audio_path = os.path.join(self.audio_dir, turn["audio"]) if turn["audio"] else None
+        if not audio_path or not os.path.isfile(audio_path):
+            await self.ws.send_json(MESSAGES["audio_finish"]())
+            return
+
+        with open(audio_path, "rb") as f:
+            data = f.read()
+        await asyncio.sleep(self.scenario.delay(turn["first_audio_delay_ms"]))
+        await self.ws.send_json(MESSAGES["tts_start"](turn["codec"]))
+
+        args = self.scenario.args
+        chunks = iter_opus_packets(data) if turn["codec"] == "opus" else iter_mp3_chunks(data, args.chunk_size)
+        sent = 0
+        dropped = 0
+        first_audio_ms = (time.monotonic() - self.turn_start) * 1000
+        for chunk in chunks:
+            if self.scenario.lost():
+                dropped += 1
+                continue
+            await self.ws.send(OP_BINARY, chunk)
+            sent += len(chunk)
+            if args.chunk_interval_ms:
+                await asyncio.sleep(self.scenario.delay(args.chunk_interval_ms))
+        await self.ws.send_json(MESSAGES["audio_finish"]())
+        log("turn %d: first audio at %.0f ms, sent %d bytes, dropped %d chunks", index, first_audio_ms,
+            sent, dropped)
+
+
+class MockServer:
+    def __init__(self, args):
+        self.args = args
+        self.scenario = Scenario(args)
+        self.tts_map = {}
+
+    async def handle(self, reader, writer):
+        try:
+            while True:
+                request_line = await reader.readline()
+                if not request_line:
+                    break
+                method, target, _ = request_line.decode("latin-1").split(" ", 2)
+                headers = {}
+                while True:
+                    line = await reader.readline()
+                    if line in (b"\r\n", b"\n", b""):
+                        break
+                    key, _, value = line.decode("latin-1").partition(":")
+                    headers[key.strip().lower()] = value.strip()
+                body = b""
+                if "content-length" in headers:
+                    body = await reader.readexactly(int(headers["content-length"]))
+
+                path = urlsplit(target).path
+                if headers.get("upgrade", "").lower() == "websocket":
+                    await self.handle_websocket(reader, writer, headers)
+                    return
+                keep_alive = await self.handle_http(writer, method, path, headers, body)
+                if not keep_alive:
+                    break
+        except (asyncio.IncompleteReadError, ConnectionError, ValueError):
+            pass
+        finally:
+            writer.close()
+
+    async def handle_websocket(self, reader, writer, headers):
+        accept = base64.b64encode(hashlib.sha1((headers["sec-websocket-key"] + WS_GUID).encode()).digest()).decode()
+        response = ("HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                    "Sec-WebSocket-Accept: %s\r\n\r\n" % accept)
+        await asyncio.sleep(self.scenario.delay(self.args.connect_delay_ms))
+        writer.write(response.encode())
+        await writer.drain()
+        log("ws connected: %s", writer.get_extra_info("peername"))
+        await ChatSession(WebSocket(reader, writer), self.scenario, self.args.audio_dir).run()
+        log("ws closed")
+
+    async def send_response(self, writer, status, body, content_type="application/json", extra=None):
+        if isinstance(body, str):
+            body = body.encode("utf-8")
+        head = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: keep-alive\r\n" % (
+            status, content_type, len(body))
+        head += "Date: %s\r\n" % time.strftime("%a, %d %b %Y %H:%M:%S GMT", time.gmtime())
+        for key, value in (extra or {}).items():
+            head += "%s: %s\r\n" % (key, value)
+        writer.write(head.encode() + b"\r\n" + body)
+        await writer.drain()
+
+    async def send_file(self, writer, file_path, headers, content_type):
+        if not os.path.isfile(file_path):
+            await self.send_response(writer, "404 Not Found", "")
+            return
+        with open(file_path, "rb") as f:
+            data = f.read()
+        status = "200 OK"
+        extra = {"Accept-Ranges": "bytes"}
+        byte_range = parse_range(headers.get("range", ""), len(data))
+        if byte_range == "unsatisfiable":
+            await self.send_response(writer, "416 Range Not Satisfiable", "", extra={
+                "Content-Range": "bytes */%d" % len(data)})
+            return
+        if byte_range:
+            start, end = byte_range
+            extra["Content-Range"] = "bytes %d-%d/%d" % (start, end, len(data))
+            data = data[start:end + 1]
+            status = "206 Partial Content"
+        if self.scenario.lost():
+            # 模拟传输中断: 只发送一半后断开
+            half = len(data) // 2
+            head = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n\r\n" % (status, content_type, len(data))
+            writer.write(head.encode() + data[:half])
+            await writer.drain()
+            raise ConnectionError("mock loss")
+        await self.send_response(writer, status, data, content_type, extra)
+
+    async def handle_http(self, writer, method, path, headers, body):
+        args = self.args
+        host = headers.get("host", "127.0.0.1:%d" % args.port)
+        log("http %s %s %s", method, host, path)
+        await asyncio.sleep(self.scenario.delay(args.http_delay_ms))
+
+        if method == "POST" and path.endswith("/tts/template"):
+            try:
+                text = json.loads(body.decode("utf-8")).get("prompt", "")
+            except ValueError:
+                text = ""
+            name = self.tts_map.setdefault(text, "tts_%d.mp3" % len(self.tts_map))
+            url = "http://%s:%d/media/%s" % (args.media_host or host.split(":")[0], args.port, name)
+            await self.send_response(writer, "200 OK", json.dumps({"resultCode": 0, "resultMsg": "ok", "data": url}))
+            return True
+
+        if method == "POST" and path.endswith("/ota/checkUpdate"):
+            req = {}
+            try:
+                req = json.loads(body.decode("utf-8"))
+            except ValueError:
+                pass
+            if not args.firmware or req.get("version") == args.firmware_version:
+                rsp = {"resultCode": 1, "resultMsg": "no update"}
+            else:
+                url = "http://%s:%d/firmware/%s" % (args.media_host or host.split(":")[0], args.port,
+                                                     os.path.basename(args.firmware))
+                rsp = {"resultCode": 0, "resultMsg": "ok", "data": {
+                    "version": args.firmware_version, "url": url, "firmwareSize": os.path.getsize(args.firmware)}}
+            await self.send_response(writer, "200 OK", json.dumps(rsp))
+            return True
+
+        if method == "GET" and path.startswith("/media/"):
+            name = os.path.basename(path)
+            if name.startswith("tts_") and name not in os.listdir(args.audio_dir):
+                name = args.tts_audio
+            await self.send_file(writer, os.path.join(args.audio_dir, name), headers, "audio/mpeg")
+            return True
+
+        if method == "GET" and path.startswith("/firmware/") and args.firmware:
+            await self.send_file(writer, args.firmware, headers, "application/octet-stream")
+            return True
+
+        await self.send_response(writer, "404 Not Found", "")
+        return True
+
+
+async def main(args):
+    server = MockServer(args)
+    servers = [await asyncio.start_server(server.handle, args.bind, args.port)]
+    if args.ota_port and args.ota_port != args.port:
+        servers.append(await asyncio.start_server(server.handle, args.bind, args.ota_port))
+    log("aiha mock server listen on %s:%d (ota %d), audio dir: %s", args.bind, args.port, args.ota_port,
+        args.audio_dir)
+    await asyncio.gather(*(s.serve_forever() for s in servers))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="AIHA cloud stand-in for offline latency benchmarking")
+    parser.add_argument("--bind", default="0.0.0.0")
+    parser.add_argument("--port", type=int, default=8099, help="websocket / tts / media port")
+    parser.add_argument("--ota-port", type=int, default=80, help="ota check port, 0 to disable")
+    parser.add_argument("--media-host", default="", help="host used in returned URLs, default: request Host")
+    parser.add_argument("--audio-dir", default=".", help="directory of reply / tts audio files")
+    parser.add_argument("--reply-audio", default="", help="file in audio-dir streamed as chat answer")
+    parser.add_argument("--tts-audio", default="wifi_connect.mp3", help="file in audio-dir served for any tts url")
+    parser.add_argument("--codec", choices=("mp3", "opus"), default="mp3")
+    parser.add_argument("--hashcode", type=int, default=-1154641418)
+    parser.add_argument("--volume-db", type=float, default=0.0)
+    parser.add_argument("--asr-text", default="今天天气怎么样")
+    parser.add_argument("--answer", default="")
+    parser.add_argument("--asr-delay-ms", type=int, default=300, help="upload end -> asr result")
+    parser.add_argument("--first-audio-delay-ms", type=int, default=500, help="asr result -> first audio frame")
+    parser.add_argument("--http-delay-ms", type=int, default=0, help="delay before every http response")
+    parser.add_argument("--connect-delay-ms", type=int, default=0, help="delay before websocket handshake reply")
+    parser.add_argument("--chunk-size", type=int, default=1024, help="mp3 downlink frame size")
+    parser.add_argument("--chunk-interval-ms", type=int, default=20, help="interval between downlink frames")
+    parser.add_argument("--jitter-ms", type=int, default=0, help="uniform jitter added to every delay")
+    parser.add_argument("--loss", type=float, default=0.0, help="drop probability of downlink frames / downloads")
+    parser.add_argument("--firmware", default="", help="firmware bin offered by ota check")
+    parser.add_argument("--firmware-version", default="v9.9.9")
+    parser.add_argument("--script", default="", help='json file: {"turns": [{"asr_text": ..., "asr_delay_ms": ...}]}')
+    parser.add_argument("--seed", type=int, default=None)
+    args = parser.parse_args()
+    random.seed(args.seed)
+    try:
+        asyncio.run(main(args))
+    except KeyboardInterrupt:
+        pass
@@ -0,0 +1,90 @@
+"""
+提示音库打包工具，生成 bank 分区镜像
+
+格式与 main/chat_notify/prompt_bank.h 保持一致(小端):
+    头部:   magic(u32) "QBNK" | version(u16) | count(u16)
+    索引:   count 个 { id(char[24]) | hashcode(i32) | offset(u32) | size(u32) | crc32(u32) }
+    数据:   按 16 字节对齐依次存放 mp3 数据，未使用的空间填充 0xFF
+
+文件名格式为 <id>@<hashcode>.mp3 或 <id>.mp3(hashcode 为 0)，id 与通知的 path 相同
+
+用法:
+    python mkbank.py --size 0x20000 -o prompt_bank.bin tone_res/wakeup@-1154641418.mp3 ...
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+BANK_MAGIC = 0x4B4E4251  # "QBNK"
+BANK_VERSION = 1
+BANK_ALIGN = 16
+BANK_ID_SIZE = 24
+BANK_ENTRY_MAX = 16
+
+HEADER_FMT = "<IHH"
+ENTRY_FMT = "<%dsiIII" % BANK_ID_SIZE
+
+
+def align_up(value):
+    return (value + BANK_ALIGN - 1) & ~(BANK_ALIGN - 1)
+
+
+def parse_name(path):
+    # wakeup@-1154641418.mp3 -> ("wakeup", -1154641418)
+    name = os.path.splitext(os.path.basename(path))[0]
+    if "@" in name:
+        prompt_id, hashcode = name.split("@", 1)
+        return prompt_id, int(hashcode)
+    return name, 0
+
+
+def build(files, size):
+    if len(files) > BANK_ENTRY_MAX:
+        raise ValueError("too many prompts: %d > %d" % (len(files), BANK_ENTRY_MAX))
+
+    offset = align_up(struct.calcsize(HEADER_FMT) + len(files) * struct.calcsize(ENTRY_FMT))
+    entries = b""
+    blobs = bytearray(b"\xff" * offset)
+    for path in sorted(files):
+        prompt_id, hashcode = parse_name(path)
+        if len(prompt_id.encode()) >= BANK_ID_SIZE:
+            raise ValueError("prompt id too long: %s" % prompt_id)
+        with open(path, "rb") as f:
+            data = f.read()
+        entries += struct.pack(ENTRY_FMT, prompt_id.encode(), hashcode, offset, len(data), zlib.crc32(data) & 0xFFFFFFFF)
+        print("  %-24s hashcode=%-12d offset=0x%05x size=%d" % (prompt_id, hashcode, offset, len(data)))
+        blobs[offset:] = data
+        offset = align_up(offset + len(data))
+        blobs += b"\xff" * (offset - len(blobs))
+
+    header = struct.pack(HEADER_FMT, BANK_MAGIC, BANK_VERSION, len(files))
+    blobs[: len(header) + len(entries)] = header + entries
+    if len(blobs) > size:
+        raise ValueError("prompt bank overflow: %d > %d" % (len(blobs), size))
+    blobs += b"\xff" * (size - len(blobs))
+    return bytes(blobs)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pack mp3 prompts into a bank partition image")
+    parser.add_argument("--size", type=lambda x: int(x, 0), required=True, help="分区大小")
+    parser.add_argument("-o", "--output", required=True, help="输出镜像路径")
+    parser.add_argument("files", nargs="*", help="mp3 文件")
+    args = parser.parse_args()
+
+    try:
+        image = build(args.files, args.size)
+    except (OSError, ValueError) as e:
+        print("mkbank: %s" % e, file=sys.stderr)
+        return 1
+    with open(args.output, "wb") as f:
+        f.write(image)
+    print("mkbank: %d prompts -> %s" % (len(args.files), args.output))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,153 @@
+"""
+OTA 压缩包生成工具，设备端由 main/network/qmsd_ota_heatshrink.c 边下载边解压
+
+格式与 main/network/qmsd_ota_heatshrink.h 保持一致(小端):
+    头部:   magic(u32) "QHSZ" | version(u8) | window_bits(u8) | lookahead_bits(u8) | reserved(u8) |
+            raw_size(u32) | raw_sha256(32)
+    数据:   heatshrink 位流(高位在前)
+            1 + 8 位字面量
+            0 + window_bits 位 (距离 - 1) + lookahead_bits 位 (长度 - 1)
+
+输入可以是完整的 app 镜像，也可以是 mkdelta.py 生成的差分包，设备解压后按内容分别处理。
+窗口越大压缩率越高，设备解压需要 2^window_bits 字节内存，不能超过 QMSD_OTA_HEATSHRINK_WINDOW_BITS_MAX
+
+用法:
+    python mkcompress.py -w 11 -l 4 -o ZXAIEC43A.bin.qhsz build/ZXAIEC43A.bin
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+HS_MAGIC = 0x5A534851  # "QHSZ"
+HS_VERSION = 1
+HEADER_FMT = "<IBBBBI32s"
+WINDOW_BITS_MAX = 12
+
+HASH_LEN = 3     # 建立哈希链的前缀长度
+CHAIN_MAX = 64   # 每个位置最多比较的候选数
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.bits = 0
+        self.count = 0
+
+    def write(self, value, count):
+        self.bits = (self.bits << count) | value
+        self.count += count
+        while self.count >= 8:
+            self.count -= 8
+            self.out.append((self.bits >> self.count) & 0xFF)
+        self.bits &= (1 << self.count) - 1
+
+    def finish(self):
+        if self.count:
+            self.out.append((self.bits << (8 - self.count)) & 0xFF)
+        return bytes(self.out)
+
+
+def compress(data, window_bits, lookahead_bits):
+    window = 1 << window_bits
+    lookahead = 1 << lookahead_bits
+    # 回溯的位数不少于字面量时才使用回溯
+    min_len = (1 + window_bits + lookahead_bits) // 9 + 1
+    writer = BitWriter()
+    head = {}
+    prev = [0] * len(data)
+
+    def insert(pos):
+        key = data[pos:pos + HASH_LEN]
+        prev[pos] = head.get(key, -1)
+        head[key] = pos
+
+    pos = 0
+    while pos < len(data):
+        best_len = 0
+        best_dist = 0
+        limit = min(lookahead, len(data) - pos)
+        if limit >= HASH_LEN:
+            cand = head.get(data[pos:pos + HASH_LEN], -1)
+            chain = 0
+            while cand >= 0 and pos - cand <= window and chain < CHAIN_MAX:
+                n = HASH_LEN
+                while n < limit and data[cand + n] == data[pos + n]:
+                    n += 1
+                if n > best_len:
+                    best_len = n
+                    best_dist = pos - cand
+                    if n == limit:
+                        break
+                cand = prev[cand]
+                chain += 1
+        if best_len >= min_len:
+            writer.write(0, 1)
+            writer.write(best_dist - 1, window_bits)
+            writer.write(best_len - 1, lookahead_bits)
+            step = best_len
+        else:
+            writer.write(1, 1)
+            writer.write(data[pos], 8)
+            step = 1
+        for i in range(pos, min(pos + step, len(data) - HASH_LEN + 1)):
+            insert(i)
+        pos += step
+    return writer.finish()
+
+
+def decompress(stream, window_bits, lookahead_bits, raw_size):
+    # 与设备端相同的解码流程，用于生成后自检
+    out = bytearray()
+    state = {"pos": 0, "bits": 0, "count": 0}
+
+    def take(count):
+        while state["count"] < count:
+            if state["pos"] >= len(stream):
+                sys.exit("truncated stream")
+            state["bits"] = (state["bits"] << 8) | stream[state["pos"]]
+            state["pos"] += 1
+            state["count"] += 8
+        state["count"] -= count
+        value = state["bits"] >> state["count"]
+        state["bits"] &= (1 << state["count"]) - 1
+        return value
+
+    while len(out) < raw_size:
+        if take(1):
+            out.append(take(8))
+        else:
+            dist = take(window_bits) + 1
+            count = take(lookahead_bits) + 1
+            for _ in range(count):
+                out.append(out[-dist] if dist <= len(out) else 0)
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="compress ota image or delta patch")
+    parser.add_argument("-w", "--window-bits", type=int, default=11, help="window size 2^w bytes")
+    parser.add_argument("-l", "--lookahead-bits", type=int, default=4, help="max match length 2^l bytes")
+    parser.add_argument("-o", "--output", required=True, help="output file")
+    parser.add_argument("input", help="app image or delta patch")
+    args = parser.parse_args()
+
+    if not 4 <= args.window_bits <= WINDOW_BITS_MAX or not 3 <= args.lookahead_bits < args.window_bits:
+        sys.exit("window bits must be 4..%d and lookahead bits 3..window bits - 1" % WINDOW_BITS_MAX)
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    stream = compress(data, args.window_bits, args.lookahead_bits)
+    if decompress(stream, args.window_bits, args.lookahead_bits, len(data)) != data:
+        sys.exit("self check failed")
+    header = struct.pack(HEADER_FMT, HS_MAGIC, HS_VERSION, args.window_bits, args.lookahead_bits, 0, len(data),
+                         hashlib.sha256(data).digest())
+    with open(args.output, "wb") as f:
+        f.write(header + stream)
+    print("%s: %d -> %d bytes (%.1f%%)" % (args.output, len(data), len(header) + len(stream),
+                                          (len(header) + len(stream)) * 100.0 / len(data)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,194 @@
+"""
+差分升级包生成工具，生成的差分包由 main/network/qmsd_ota_delta.c 在设备上流式应用
+
+格式与 main/network/qmsd_ota_delta.h 保持一致(小端):
+    头部:   magic(u32) "QDLT" | version(u16) | reserved(u16) | src_size(u32) | dst_size(u32) |
+            src_elf_sha256(32) | dst_sha256(32)
+    操作:   COPY(1)   src_offset(u32) | len(u32)
+            ADD(2)    src_offset(u32) | len(u32) | diff[len]   新数据 = 旧数据 + diff (mod 256)
+            INSERT(3) len(u32) | data[len]
+            END(0)
+
+src_elf_sha256 取自旧镜像的 app 描述，设备只接受基于当前运行固件的差分包；
+dst_sha256 为完整新镜像的 sha256，设备生成新镜像后校验
+
+用法:
+    python mkdelta.py -o v1.0.1-from-v1.0.0.qdlt old/ZXAIEC43A.bin build/ZXAIEC43A.bin
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+DELTA_MAGIC = 0x544C4451  # "QDLT"
+DELTA_VERSION = 1
+HEADER_FMT = "<IHHII32s32s"
+
+OP_END = 0
+OP_COPY = 1
+OP_ADD = 2
+OP_INSERT = 3
+
+# 镜像头(24) + 第一个段头(8) 之后是 esp_app_desc_t，其中 app_elf_sha256 的偏移为 144
+APP_ELF_SHA256_OFFSET = 24 + 8 + 144
+ESP_IMAGE_MAGIC = 0xE9
+
+BLOCK = 16        # 匹配的最小长度
+INDEX_STEP = 4    # 旧镜像按该步长建立索引
+ADD_SCAN = 4096   # 精确匹配结束后，近似匹配(ADD)向后扫描的最大长度
+ADD_SPLIT = 12    # 近似匹配区域内连续相同超过该长度时改用 COPY，差分包不压缩时 diff 中的 0 也占空间
+
+
+def elf_sha256(image, name):
+    if len(image) < APP_ELF_SHA256_OFFSET + 32 or image[0] != ESP_IMAGE_MAGIC:
+        sys.exit("%s is not an app image" % name)
+    return image[APP_ELF_SHA256_OFFSET:APP_ELF_SHA256_OFFSET + 32]
+
+
+def match_len(old, old_pos, new, new_pos):
+    n = 0
+    limit = min(len(old) - old_pos, len(new) - new_pos)
+    # 先按 64 字节整段比较，再逐字节
+    while n + 64 <= limit and old[old_pos + n:old_pos + n + 64] == new[new_pos + n:new_pos + n + 64]:
+        n += 64
+    while n < limit and old[old_pos + n] == new[new_pos + n]:
+        n += 1
+    return n
+
+
+def add_len(old, old_pos, new, new_pos):
+    # 与 bsdiff 相同，取使 (相同字节数 * 2 - 长度) 最大的长度，地址重定位造成的零散差异用 ADD 覆盖
+    limit = min(len(old) - old_pos, len(new) - new_pos, ADD_SCAN)
+    score = 0
+    best = 0
+    best_len = 0
+    for n in range(limit):
+        score += 1 if old[old_pos + n] == new[new_pos + n] else -1
+        if score > best:
+            best = score
+            best_len = n + 1
+        elif score < best - BLOCK:
+            break
+    return best_len
+
+
+def split_add(old, old_pos, new, new_pos, n):
+    # 近似匹配区域拆成 ADD(有差异的部分) 和 COPY(较长的相同部分)
+    ops = []
+    start = 0
+    pos = 0
+    while pos < n:
+        run = 0
+        while pos + run < n and old[old_pos + pos + run] == new[new_pos + pos + run]:
+            run += 1
+        if run > ADD_SPLIT or (run > 0 and pos + run == n):
+            if pos > start:
+                diff = bytes((new[new_pos + i] - old[old_pos + i]) & 0xFF for i in range(start, pos))
+                ops.append((OP_ADD, old_pos + start, diff))
+            ops.append((OP_COPY, old_pos + pos, run))
+            start = pos + run
+        pos += max(run, 1)
+    if n > start:
+        diff = bytes((new[new_pos + i] - old[old_pos + i]) & 0xFF for i in range(start, n))
+        ops.append((OP_ADD, old_pos + start, diff))
+    return ops
+
+
+def build_ops(old, new):
+    index = {}
+    for pos in range(0, len(old) - BLOCK + 1, INDEX_STEP):
+        index.setdefault(old[pos:pos + BLOCK], pos)
+
+    ops = []
+    literal = 0  # 尚未输出的新数据起点
+    pos = 0
+    while pos + BLOCK <= len(new):
+        old_pos = index.get(new[pos:pos + BLOCK])
+        if old_pos is None:
+            pos += 1
+            continue
+        # 向前扩展，把前面相同的数据并入匹配
+        while pos > literal and old_pos > 0 and new[pos - 1] == old[old_pos - 1]:
+            pos -= 1
+            old_pos -= 1
+        if pos > literal:
+            ops.append((OP_INSERT, 0, new[literal:pos]))
+        n = match_len(old, old_pos, new, pos)
+        ops.append((OP_COPY, old_pos, n))
+        pos += n
+        old_pos += n
+        n = add_len(old, old_pos, new, pos)
+        ops += split_add(old, old_pos, new, pos, n)
+        pos += n
+        literal = pos
+    if literal < len(new):
+        ops.append((OP_INSERT, 0, new[literal:]))
+    return ops
+
+
+def encode(ops, old, new):
+    out = bytearray(struct.pack(HEADER_FMT, DELTA_MAGIC, DELTA_VERSION, 0, len(old), len(new),
+                                elf_sha256(old, "old"), hashlib.sha256(new).digest()))
+    for op, offset, data in ops:
+        if op == OP_COPY:
+            out += struct.pack("<BII", op, offset, data)
+        elif op == OP_ADD:
+            out += struct.pack("<BII", op, offset, len(data)) + data
+        else:
+            out += struct.pack("<BI", op, len(data)) + data
+    out += struct.pack("<B", OP_END)
+    return bytes(out)
+
+
+def apply(old, patch):
+    # 与设备端相同的解析流程，用于生成后自检
+    magic, version, _, src_size, dst_size, _, dst_sha256 = struct.unpack_from(HEADER_FMT, patch)
+    assert magic == DELTA_MAGIC and version == DELTA_VERSION and src_size == len(old)
+    pos = struct.calcsize(HEADER_FMT)
+    out = bytearray()
+    while True:
+        op = patch[pos]
+        pos += 1
+        if op == OP_END:
+            break
+        if op == OP_INSERT:
+            (n,) = struct.unpack_from("<I", patch, pos)
+            out += patch[pos + 4:pos + 4 + n]
+            pos += 4 + n
+            continue
+        offset, n = struct.unpack_from("<II", patch, pos)
+        pos += 8
+        if op == OP_COPY:
+            out += old[offset:offset + n]
+        else:
+            out += bytes((old[offset + i] + patch[pos + i]) & 0xFF for i in range(n))
+            pos += n
+    assert pos == len(patch) and len(out) == dst_size and hashlib.sha256(out).digest() == dst_sha256
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generate delta ota patch")
+    parser.add_argument("-o", "--output", required=True, help="output patch file")
+    parser.add_argument("old", help="app image running on the device")
+    parser.add_argument("new", help="new app image")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+    elf_sha256(new, "new")
+
+    patch = encode(build_ops(old, new), old, new)
+    if apply(old, patch) != new:
+        sys.exit("self check failed")
+    with open(args.output, "wb") as f:
+        f.write(patch)
+    print("%s: %d -> %d bytes, patch %d bytes (%.1f%%)" % (args.output, len(old), len(new), len(patch),
+                                                        len(patch) * 100.0 / len(new)))
+
+
+if __name__ == "__main__":
+    main()
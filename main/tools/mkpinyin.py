@@ -0,0 +1,95 @@
+"""
+拼音表生成工具，生成 main/chat/chat_pinyin_table.h
+
+只收录本地命令关键词及 ASR 常见的同音、近音误识别字，每个字只取最常用读音(不带声调)。
+新增命令关键词时，把关键词中的字加入 SYLLABLES 后重新生成；表中没有的字所在的关键词只做精确匹配。
+
+表项为 { unicode(u16) | 音节序号(u8) }，按 unicode 排序，匹配时二分查找，整张表放在 flash 中。
+
+用法:
+    python mkpinyin.py -o ../chat/chat_pinyin_table.h
+"""
+
+import argparse
+import sys
+
+# 音节: 汉字
+SYLLABLES = [
+    ("an", "安按暗岸案"),
+    ("bi", "闭比笔必毕币壁避鼻逼彼"),
+    ("bo", "播波博伯剥拨"),
+    ("bu", "不步部布补捕卜"),
+    ("chu", "出处初除触楚础储厨"),
+    ("da", "大打达答搭"),
+    ("deng", "灯等登邓瞪"),
+    ("di", "低底地第弟敌递滴"),
+    ("dian", "点电店典"),
+    ("duo", "多朵躲夺"),
+    ("fang", "放方房防访仿"),
+    ("gao", "高告搞稿糕"),
+    ("guan", "关管观官惯灌"),
+    ("ji", "继几机记级即急极计技集"),
+    ("jing", "静镜经精井景境京"),
+    ("kai", "开凯慨"),
+    ("lian", "连脸练联恋莲"),
+    ("liang", "量亮两良凉粮梁辆谅晾"),
+    ("niang", "娘酿"),
+    ("shao", "少烧稍勺"),
+    ("shen", "身深神什伸审甚肾"),
+    ("sheng", "声生升胜省剩圣绳牲"),
+    ("shuo", "说硕烁朔"),
+    ("tiao", "调条跳挑"),
+    ("ting", "停听厅庭挺"),
+    ("tui", "退推腿颓蜕"),
+    ("xia", "下夏吓虾侠峡瞎霞"),
+    ("xiao", "小笑校效晓消销"),
+    ("xie", "些写谢鞋协"),
+    ("xu", "续需须许序虚"),
+    ("yao", "要药摇咬腰遥耀邀"),
+    ("yi", "一以已意衣医依易"),
+    ("yin", "音因阴银引印饮隐殷吟寅"),
+    ("ying", "应英影迎营赢硬映莹鹰樱"),
+    ("zai", "再在载灾仔宰"),
+    ("zan", "暂赞咱攒"),
+    ("zhi", "只知之直指止至制"),
+    ("zhong", "中种重钟终众"),
+    ("zui", "嘴最醉罪"),
+]
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generate pinyin table")
+    parser.add_argument("-o", "--output", required=True, help="output header")
+    args = parser.parse_args()
+
+    table = {}
+    for index, (syllable, chars) in enumerate(SYLLABLES):
+        for char in chars:
+            if char in table:
+                sys.exit("duplicate char %s in %s and %s" % (char, SYLLABLES[table[char]][0], syllable))
+            if ord(char) > 0xFFFF:
+                sys.exit("char %s out of BMP" % char)
+            table[char] = index
+
+    lines = [
+        "// 由 main/tools/mkpinyin.py 生成，不要手动修改",
+        "#pragma once",
+        "",
+        "#include <stdint.h>",
+        "",
+        "static const char* const chat_pinyin_syllables[] = {",
+    ]
+    for syllable, _ in SYLLABLES:
+        lines.append('    "%s",' % syllable)
+    lines += ["};", "", "static const struct {", "    uint16_t code;", "    uint8_t syllable;", "} chat_pinyin_table[] = {"]
+    for char in sorted(table, key=ord):
+        lines.append("    { 0x%04x, %d },  // %s" % (ord(char), table[char], char))
+    lines += ["};", ""]
+
+    with open(args.output, "w", encoding="utf-8") as f:
+        f.write("\n".join(lines))
+    print("%d syllables, %d chars" % (len(SYLLABLES), len(table)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,54 @@
+"""
+资源包清单生成工具，设备端由 main/chat_notify/res_pack.c 按清单增量更新 res 分区中的文件
+
+清单格式:
+    {"version": 3, "base": "https://cdn.example.com/res/v3/",
+     "files": [{"name": "wifi_ap_not_found.mp3", "size": 1234, "crc32": 305419896}, ...]}
+
+crc32 与设备端 esp_rom_crc32_le(0, ...) 相同。文件名不能包含目录和 @(音色文件由 chat_notify 同步)，
+文件按原名上传到 base 下；清单中没有列出的文件设备不会删除，除非上一版清单中有而新清单中没有
+
+用法:
+    python mkrespack.py --version 3 --base https://cdn.example.com/res/v3/ -o manifest.json tone_res
+"""
+
+import argparse
+import json
+import os
+import sys
+import zlib
+
+NAME_SIZE = 48
+FILE_MAX = 64
+RESERVED_EXT = (".new", ".idx", ".pnd", ".tmp", ".part")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="generate resource pack manifest")
+    parser.add_argument("--version", type=int, required=True, help="resource pack version, must change on every release")
+    parser.add_argument("--base", required=True, help="url prefix of the uploaded files")
+    parser.add_argument("-o", "--output", required=True, help="output manifest file")
+    parser.add_argument("dir", help="resource directory, same as the littlefs image source")
+    args = parser.parse_args()
+
+    files = []
+    for name in sorted(os.listdir(args.dir)):
+        path = os.path.join(args.dir, name)
+        if not os.path.isfile(path):
+            continue
+        if "@" in name or len(name.encode()) >= NAME_SIZE or os.path.splitext(name)[1] in RESERVED_EXT:
+            print("skip %s" % name)
+            continue
+        with open(path, "rb") as f:
+            data = f.read()
+        files.append({"name": name, "size": len(data), "crc32": zlib.crc32(data) & 0xFFFFFFFF})
+    if len(files) > FILE_MAX:
+        sys.exit("too many files: %d > %d" % (len(files), FILE_MAX))
+
+    with open(args.output, "w") as f:
+        json.dump({"version": args.version, "base": args.base, "files": files}, f, indent=1)
+    print("%s: version %d, %d files, %d bytes" % (args.output, args.version, len(files), sum(x["size"] for x in files)))
+
+
+if __name__ == "__main__":
+    main()